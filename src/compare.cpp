@@ -0,0 +1,82 @@
+#include"compare.h"
+
+#include<cmath>
+#include<cstdlib>
+#include<limits>
+#include<algorithm>
+
+static float luminance(const std::vector<unsigned char>& image, int index) {
+	return 0.299f * image[index * 3] + 0.587f * image[index * 3 + 1] + 0.114f * image[index * 3 + 2];
+}
+
+// SSIM (Wang et al.) on the luminance over non-overlapping 8x8 windows, which is cheap and
+// close enough to the gaussian-weighted version to catch structural changes in the lighting
+static double structuralSimilarity(const std::vector<unsigned char>& expected, const std::vector<unsigned char>& actual, int width, int height) {
+	const int WINDOW = 8;
+	const double C1 = (0.01 * 255.0) * (0.01 * 255.0);
+	const double C2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+	double total = 0.0;
+	long windows = 0;
+	for (int wy = 0; wy + WINDOW <= height; wy += WINDOW) {
+		for (int wx = 0; wx + WINDOW <= width; wx += WINDOW) {
+			double sumA = 0.0, sumB = 0.0, sumAA = 0.0, sumBB = 0.0, sumAB = 0.0;
+			for (int y = wy; y < wy + WINDOW; y++) {
+				for (int x = wx; x < wx + WINDOW; x++) {
+					const double a = luminance(expected, y * width + x);
+					const double b = luminance(actual, y * width + x);
+					sumA += a;
+					sumB += b;
+					sumAA += a * a;
+					sumBB += b * b;
+					sumAB += a * b;
+				}
+			}
+			const double n = WINDOW * WINDOW;
+			const double meanA = sumA / n, meanB = sumB / n;
+			const double varA = sumAA / n - meanA * meanA;
+			const double varB = sumBB / n - meanB * meanB;
+			const double covariance = sumAB / n - meanA * meanB;
+
+			total += ((2.0 * meanA * meanB + C1) * (2.0 * covariance + C2)) /
+				((meanA * meanA + meanB * meanB + C1) * (varA + varB + C2));
+			windows++;
+		}
+	}
+	return (windows > 0) ? total / windows : 1.0;
+}
+
+ImageDifference compareImages(const std::vector<unsigned char>& expected, const std::vector<unsigned char>& actual,
+	int width, int height, int tolerance, std::vector<unsigned char>* diffImage) {
+	ImageDifference result = { 0, 0, 0.0, 1.0 };
+	const long pixels = (long)width * height;
+
+	if (diffImage) diffImage->assign(pixels * 3, 0);
+
+	double squaredError = 0.0;
+	for (long i = 0; i < pixels; i++) {
+		int pixelMax = 0;
+		for (int c = 0; c < 3; c++) {
+			const int difference = std::abs((int)expected[i * 3 + c] - (int)actual[i * 3 + c]);
+			squaredError += difference * difference;
+			pixelMax = std::max(pixelMax, difference);
+			if (diffImage) (*diffImage)[i * 3 + c] = (unsigned char)std::min(difference * 8, 255);
+		}
+		result.maxDifference = std::max(result.maxDifference, pixelMax);
+
+		if (pixelMax > tolerance) {
+			result.pixelsOverTolerance++;
+			if (diffImage) {
+				(*diffImage)[i * 3] = 255;
+				(*diffImage)[i * 3 + 1] = 0;
+				(*diffImage)[i * 3 + 2] = 0;
+			}
+		}
+	}
+
+	const double meanSquaredError = squaredError / (pixels * 3.0);
+	result.psnr = (meanSquaredError > 0.0) ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : std::numeric_limits<double>::infinity();
+	result.ssim = structuralSimilarity(expected, actual, width, height);
+
+	return result;
+}
@@ -0,0 +1,18 @@
+#ifndef COMPARE_H
+#define COMPARE_H
+
+#include<vector>
+
+struct ImageDifference {
+	int maxDifference;		// largest channel difference, 0-255
+	long pixelsOverTolerance;	// pixels with a channel differing by more than the tolerance
+	double psnr;			// in dB over all channels, infinite for identical images
+	double ssim;			// mean SSIM of the luminance over 8x8 windows
+};
+
+// Compares two tightly packed 8-bit RGB images of the same size. When diffImage is given it
+// receives an RGB image with the absolute difference amplified and over-tolerance pixels in red
+ImageDifference compareImages(const std::vector<unsigned char>& expected, const std::vector<unsigned char>& actual,
+	int width, int height, int tolerance, std::vector<unsigned char>* diffImage);
+
+#endif
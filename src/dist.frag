@@ -6,10 +6,16 @@ in vec4 color;
 out vec4 FragColor;
 
 uniform sampler2D u_jfaTexture;
+uniform sampler2D u_jfaInteriorTexture;
+uniform int u_signedField; // subtract the distance to the nearest empty texel
 
 void main() {
 	vec2 fixedUv = ((uv + 1.0f) / 2.0f);
     vec2 nearestSeed = texture(u_jfaTexture, fixedUv).xy;
 	float dist = clamp(distance(fixedUv, nearestSeed), 0.0, 1.0);
+	if (u_signedField == 1) {
+		vec2 nearestEmpty = texture(u_jfaInteriorTexture, fixedUv).xy;
+		dist -= clamp(distance(fixedUv, nearestEmpty), 0.0, 1.0);
+	}
 	FragColor = vec4(vec3(dist), 1.0f);
 }
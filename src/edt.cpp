@@ -0,0 +1,88 @@
+#include"edt.h"
+
+#include<cmath>
+#include<algorithm>
+
+const float EDT_INF = 1e20f;
+
+// 1D squared distance transform of f along a row/column (lower envelope of parabolas)
+static void transform1D(const float* f, float* d, int n, std::vector<int>& v, std::vector<float>& z) {
+	int k = 0;
+	v[0] = 0;
+	z[0] = -EDT_INF;
+	z[1] = EDT_INF;
+	for (int q = 1; q < n; q++) {
+		float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+		while (s <= z[k]) {
+			k--;
+			s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = EDT_INF;
+	}
+
+	k = 0;
+	for (int q = 0; q < n; q++) {
+		while (z[k + 1] < q) k++;
+		d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+	}
+}
+
+std::vector<float> exactDistanceTransform(const std::vector<unsigned char>& mask, int width, int height) {
+	std::vector<float> grid(width * height);
+	for (int i = 0; i < width * height; i++) {
+		grid[i] = mask[i] ? 0.0f : EDT_INF;
+	}
+
+	const int n = std::max(width, height);
+	std::vector<float> f(n), d(n), z(n + 1);
+	std::vector<int> v(n);
+
+	// Columns, then rows
+	for (int x = 0; x < width; x++) {
+		for (int y = 0; y < height; y++) f[y] = grid[y * width + x];
+		transform1D(f.data(), d.data(), height, v, z);
+		for (int y = 0; y < height; y++) grid[y * width + x] = d[y];
+	}
+	for (int y = 0; y < height; y++) {
+		transform1D(&grid[y * width], d.data(), width, v, z);
+		std::copy(d.begin(), d.begin() + width, grid.begin() + y * width);
+	}
+
+	for (float& value : grid) value = std::sqrt(value);
+	return grid;
+}
+
+SeedError measureSeedError(const std::vector<float>& canvas, const std::vector<float>& seeds, int width, int height) {
+	SeedError error = { 0.0f, 0.0f, 0 };
+
+	std::vector<unsigned char> mask(width * height);
+	bool anySeed = false;
+	for (int i = 0; i < width * height; i++) {
+		mask[i] = canvas[i * 4 + 3] > 0.0f;
+		anySeed = anySeed || mask[i];
+	}
+	if (!anySeed) return error; // empty canvas, nothing to compare
+
+	std::vector<float> exact = exactDistanceTransform(mask, width, height);
+
+	double errorSum = 0.0;
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			const int i = y * width + x;
+			// Seeds are stored as texel centers in uv space, (-2, -2) when none was found
+			const float dx = seeds[i * 4 + 0] * width - (x + 0.5f);
+			const float dy = seeds[i * 4 + 1] * height - (y + 0.5f);
+			const float jfaDist = std::sqrt(dx * dx + dy * dy);
+
+			const float e = std::fabs(jfaDist - exact[i]);
+			error.maxError = std::max(error.maxError, e);
+			errorSum += e;
+			if (e > 0.5f) error.wrongTexels++;
+		}
+	}
+	error.meanError = float(errorSum / (width * height));
+	return error;
+}
@@ -0,0 +1,20 @@
+#ifndef EDT_H
+#define EDT_H
+
+#include<vector>
+
+// Exact Euclidean distance transform (Felzenszwalb & Huttenlocher), returning for every texel
+// the distance in texels to the nearest texel whose mask is set
+std::vector<float> exactDistanceTransform(const std::vector<unsigned char>& mask, int width, int height);
+
+struct SeedError {
+	float maxError;		// in texels
+	float meanError;	// in texels, over all texels
+	int wrongTexels;	// texels whose seed is more than half a texel off the exact distance
+};
+
+// Compares the RGBA32F nearest-seed map produced by the JFA against the exact transform of the
+// canvas alpha (both read back as RGBA floats, seeds in [0, 1] uv space)
+SeedError measureSeedError(const std::vector<float>& canvas, const std::vector<float>& seeds, int width, int height);
+
+#endif
@@ -0,0 +1,78 @@
+#include"extent.h"
+
+#include<algorithm>
+
+OccupiedExtent::OccupiedExtent(int tilesX, int tilesY, int tileSize, int width, int height)
+	: valid(false), minX(0), minY(0), maxX(0), maxY(0), tilesX(tilesX), tilesY(tilesY), tileSize(tileSize),
+	width(width), height(height), rowWords((tilesX + 31) / 32), fence(NULL) {
+	glGenBuffers(1, &ID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+	glBufferData(GL_COPY_WRITE_BUFFER, rowWords * tilesY * sizeof(GLuint), NULL, GL_STREAM_READ);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void OccupiedExtent::request(GLuint occupancyBuffer) {
+	if (fence != NULL) glDeleteSync(fence);
+	valid = false;
+
+	glBindBuffer(GL_COPY_READ_BUFFER, occupancyBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, rowWords * tilesY * sizeof(GLuint));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool OccupiedExtent::poll() {
+	if (fence == NULL) return false;
+
+	GLint status = GL_UNSIGNALED;
+	glGetSynciv(fence, GL_SYNC_STATUS, 1, NULL, &status);
+	if (status != GL_SIGNALED) return false;
+	glDeleteSync(fence);
+	fence = NULL;
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+	const GLuint* words = (const GLuint*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, rowWords * tilesY * sizeof(GLuint), GL_MAP_READ_BIT);
+	if (words == NULL) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return false;
+	}
+
+	int minTileX = tilesX, minTileY = tilesY, maxTileX = -1, maxTileY = -1;
+	for (int y = 0; y < tilesY; y++) {
+		for (size_t word = 0; word < rowWords; word++) {
+			const GLuint bits = words[y * rowWords + word];
+			if (bits == 0) continue;
+
+			// Lowest and highest set bit of the word
+			int low = 0, high = 31;
+			while (!(bits & (1u << low))) low++;
+			while (!(bits & (1u << high))) high--;
+
+			minTileX = std::min(minTileX, int(word * 32) + low);
+			maxTileX = std::max(maxTileX, int(word * 32) + high);
+			minTileY = std::min(minTileY, y);
+			maxTileY = y;
+		}
+	}
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	minX = minTileX * tileSize;
+	minY = minTileY * tileSize;
+	maxX = std::min((maxTileX + 1) * tileSize, width);
+	maxY = std::min((maxTileY + 1) * tileSize, height);
+	valid = true;
+	return true;
+}
+
+bool OccupiedExtent::empty() const {
+	return minX >= maxX || minY >= maxY;
+}
+
+void OccupiedExtent::deleteExtent() {
+	if (fence != NULL) glDeleteSync(fence);
+	glDeleteBuffers(1, &ID);
+}
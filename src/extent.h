@@ -0,0 +1,28 @@
+#ifndef EXTENT_CLASS_H
+#define EXTENT_CLASS_H
+
+#include<glad/glad.h>
+#include<cstddef>
+
+// Bounding box of the occupied tiles of the occupancy mask. request() only queues a copy of
+// the mask and a fence; poll() reduces it on the CPU once the fence has signaled, so the
+// render thread never waits on the GPU and the extent trails the mask by a frame or two
+class OccupiedExtent {
+public:
+	GLuint ID;
+	bool valid;				// the extent describes the latest requested mask
+	int minX, minY, maxX, maxY;		// in texels, max exclusive; empty when minX >= maxX
+
+	OccupiedExtent(int tilesX, int tilesY, int tileSize, int width, int height);
+
+	void request(GLuint occupancyBuffer);	// after the mask was rebuilt
+	bool poll();				// true when a new extent arrived
+	bool empty() const;
+	void deleteExtent();
+private:
+	int tilesX, tilesY, tileSize, width, height;
+	size_t rowWords;
+	GLsync fence;				// NULL when no copy is in flight
+};
+
+#endif
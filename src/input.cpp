@@ -0,0 +1,81 @@
+#include"input.h"
+
+#include<algorithm>
+
+const char INPUT_MAGIC[4] = { 'R', 'C', 'I', 'N' };
+const uint32_t INPUT_VERSION = 1;
+
+InputRecorder::InputRecorder(const char* filename) : out(filename, std::ios::binary), count(0) {
+	if (!out) {
+		std::cout << "Error: Could not open input recording " << filename << std::endl;
+	}
+	last = { 0, 0.0f, 0.0f, 0 };
+
+	// The event count is patched in by closeRecorder()
+	out.write(INPUT_MAGIC, 4);
+	out.write(reinterpret_cast<const char*>(&INPUT_VERSION), sizeof(INPUT_VERSION));
+	out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+}
+
+void InputRecorder::record(uint32_t frame, float mouseX, float mouseY, int mouseClicked) {
+	InputEvent event = { frame, mouseX, mouseY, static_cast<uint8_t>(mouseClicked) };
+	if (count > 0 && event.mouseX == last.mouseX && event.mouseY == last.mouseY && event.mouseClicked == last.mouseClicked) return;
+
+	out.write(reinterpret_cast<const char*>(&event.frame), sizeof(event.frame));
+	out.write(reinterpret_cast<const char*>(&event.mouseX), sizeof(event.mouseX));
+	out.write(reinterpret_cast<const char*>(&event.mouseY), sizeof(event.mouseY));
+	out.write(reinterpret_cast<const char*>(&event.mouseClicked), sizeof(event.mouseClicked));
+
+	last = event;
+	count++;
+}
+
+void InputRecorder::closeRecorder() {
+	out.seekp(8);
+	out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+	out.close();
+}
+
+InputReplay::InputReplay(const char* filename) : valid(false), next(0) {
+	std::ifstream in(filename, std::ios::binary);
+	char magic[4];
+	uint32_t version = 0, count = 0;
+	in.read(magic, 4);
+	in.read(reinterpret_cast<char*>(&version), sizeof(version));
+	in.read(reinterpret_cast<char*>(&count), sizeof(count));
+	if (!in || std::equal(magic, magic + 4, INPUT_MAGIC) == false || version != INPUT_VERSION) {
+		std::cout << "Error: " << filename << " is not a valid input recording!" << std::endl;
+		return;
+	}
+
+	events.resize(count);
+	for (InputEvent& event : events) {
+		in.read(reinterpret_cast<char*>(&event.frame), sizeof(event.frame));
+		in.read(reinterpret_cast<char*>(&event.mouseX), sizeof(event.mouseX));
+		in.read(reinterpret_cast<char*>(&event.mouseY), sizeof(event.mouseY));
+		in.read(reinterpret_cast<char*>(&event.mouseClicked), sizeof(event.mouseClicked));
+	}
+	if (!in) {
+		std::cout << "Error: Input recording " << filename << " is truncated!" << std::endl;
+		events.clear();
+		return;
+	}
+	valid = true;
+}
+
+void InputReplay::apply(uint32_t frame, float& mouseX, float& mouseY, int& mouseClicked, std::vector<float>& cursorSamples) {
+	while (next < events.size() && events[next].frame <= frame) {
+		mouseX = events[next].mouseX;
+		mouseY = events[next].mouseY;
+		mouseClicked = events[next].mouseClicked;
+		if (mouseClicked != 0 && events[next].frame == frame) {
+			cursorSamples.push_back(mouseX);
+			cursorSamples.push_back(mouseY);
+		}
+		next++;
+	}
+}
+
+uint32_t InputReplay::lastFrame() const {
+	return events.empty() ? 0 : events.back().frame;
+}
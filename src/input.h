@@ -0,0 +1,45 @@
+#ifndef INPUT_CLASS_H
+#define INPUT_CLASS_H
+
+#include<cstdint>
+#include<fstream>
+#include<iostream>
+#include<vector>
+
+// Binary stroke recording: a 12 byte header ("RCIN", version, event count) followed by one
+// packed 13 byte event per change of the mouse state
+struct InputEvent {
+	uint32_t frame;
+	float mouseX, mouseY;	// NDC, as stored by mouse_callback
+	uint8_t mouseClicked;	// 0 none, 1 left (light), 2 right (wall), 3 middle (emission only)
+};
+
+// Logs the mouse state seen by each frame, only writing an event when it changed
+class InputRecorder {
+public:
+	InputRecorder(const char* filename);
+
+	void record(uint32_t frame, float mouseX, float mouseY, int mouseClicked);
+	void closeRecorder();
+private:
+	std::ofstream out;
+	InputEvent last;
+	uint32_t count;
+};
+
+// Feeds a recording back into the render loop, one frame per loop iteration regardless of wall time
+class InputReplay {
+public:
+	bool valid;
+	InputReplay(const char* filename);
+
+	// Positions of the frame's events while a button was held are appended to cursorSamples
+	// (x, y pairs), like mouse_callback queues them live
+	void apply(uint32_t frame, float& mouseX, float& mouseY, int& mouseClicked, std::vector<float>& cursorSamples);
+	uint32_t lastFrame() const;
+private:
+	std::vector<InputEvent> events;
+	size_t next;
+};
+
+#endif
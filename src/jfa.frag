@@ -9,35 +9,64 @@ precision mediump float;
 in vec2 uv;
 in vec4 color;
 
-out vec4 FragColor;
+layout(location = 0) out vec4 FragColor;
+layout(location = 1) out float DistanceOut; // only bound on the last step
 
 uniform ivec2 u_resolution;
 uniform sampler2D u_inputTexture;
+uniform sampler2D u_canvasTexture;
+uniform sampler2D u_exteriorSeedTexture;
 uniform int u_offset;
+uniform int u_seedFromCanvas;    // input is the canvas, seeds are synthesized from its alpha
+uniform int u_refineWithCanvas;  // also seed from the canvas itself (full-res pass after a half-res flood)
+uniform int u_invertSeeds;       // seed the empty texels instead, for the interior distance
+uniform int u_signedDistance;    // last step of the inverted flood: write exterior minus interior distance
+
+// Same seed uv.frag would have written for the sampled (repeat-wrapped) canvas texel
+vec4 canvasSeed(vec2 sampleUv) {
+	vec2 canvasSize = vec2(textureSize(u_canvasTexture, 0));
+	vec2 texelCenter = (floor(fract(sampleUv) * canvasSize) + 0.5f) / canvasSize;
+	float alpha = texture(u_canvasTexture, sampleUv).a;
+	return vec4(texelCenter * ((u_invertSeeds == 1) ? 1.0f - alpha : alpha), 0.0f, 1.0f);
+}
+
+void considerSeed(vec4 sampleValue, vec2 fixedUv, inout vec4 nearestSeed, inout float nearestDist) {
+	vec2 sampleSeed = sampleValue.xy;
+
+	if (sampleSeed.x != 0.0 || sampleSeed.y != 0.0) {
+		vec2 diff = sampleSeed - fixedUv;
+		float dist = dot(diff, diff);
+		if (dist < nearestDist) {
+			nearestDist = dist;
+			nearestSeed = sampleValue;
+		}
+	}
+}
 
 void main() {
 	vec4 nearestSeed = vec4(-2.0);
 	float nearestDist = 9999999.9;
 
+	vec2 fixedUv = ((uv + 1.0f) / 2.0f);
+
 	for (float y = -1.0; y <= 1.0; y += 1.0) {
 		for (float x = -1.0; x <= 1.0; x += 1.0) {
-			vec2 fixedUv = ((uv + 1.0f) / 2.0f);
-			vec2 sampleUv = uv + vec2(x,y) * u_offset / u_resolution;
-			vec2 fixedSampleUv = ((sampleUv + 1.0f) / 2.0f);
-
-			vec4 sampleValue = texture(u_inputTexture, fixedSampleUv);
-			vec2 sampleSeed = sampleValue.xy;
-
-			if (sampleSeed.x != 0.0 || sampleSeed.y != 0.0) {
-				vec2 diff = sampleSeed - fixedUv;
-				float dist = dot(diff, diff);
-				if (dist < nearestDist) {
-					nearestDist = dist;
-					nearestSeed = sampleValue;
-				}
+			vec2 fixedSampleUv = fixedUv + vec2(x,y) * u_offset / u_resolution;
+
+			vec4 sampleValue = (u_seedFromCanvas == 1) ? canvasSeed(fixedSampleUv) : texture(u_inputTexture, fixedSampleUv);
+			considerSeed(sampleValue, fixedUv, nearestSeed, nearestDist);
+
+			if (u_refineWithCanvas == 1) {
+				considerSeed(canvasSeed(fixedSampleUv), fixedUv, nearestSeed, nearestDist);
 			}
 		}
 	}
 
 	FragColor = nearestSeed;
+	float dist = clamp(distance(fixedUv, nearestSeed.xy), 0.0, 1.0);
+	if (u_signedDistance == 1) {
+		vec2 exteriorSeed = texture(u_exteriorSeedTexture, fixedUv).xy;
+		dist = clamp(distance(fixedUv, exteriorSeed), 0.0, 1.0) - dist;
+	}
+	DistanceOut = dist;
 }
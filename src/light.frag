@@ -0,0 +1,31 @@
+#version 430 core
+
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;
+#else
+precision mediump float;
+#endif
+
+in vec2 uv;
+flat in vec4 segment;
+flat in vec3 emission;
+flat in float radius;
+
+// Emission is blended additively, the distance with GL_MIN so each texel keeps its nearest light
+layout(location = 0) out vec4 Emission;
+layout(location = 1) out float LightDistance;
+
+float sdfLine(vec2 p, vec2 from, vec2 to) {
+  vec2 toStart = p - from;
+  vec2 line = to - from;
+  float lineLengthSquared = dot(line, line);
+  float t = (lineLengthSquared > 0.0f) ? clamp(dot(toStart, line) / lineLengthSquared, 0.0, 1.0) : 0.0f;
+  return length(toStart - line * t);
+}
+
+void main() {
+    float dist = sdfLine(uv, segment.xy, segment.zw) - radius;
+
+    Emission = (dist <= 0.0f) ? vec4(emission, 1.0f) : vec4(0.0f);
+    LightDistance = max(dist, 0.0f);
+}
@@ -0,0 +1,37 @@
+#version 430 core
+
+// One instance per analytic light or emission stroke (brush capsules share the layout): a quad
+// covering its bounding box grown by the reach of the light distance texture
+struct Light {
+    vec4 segment;   // start.xy, end.xy in canvas uv
+    vec4 color;     // rgb, intensity
+    vec4 params;    // x: radius in canvas uv
+};
+
+layout(std430, binding = 3) readonly buffer Lights {
+    Light lights[];
+};
+
+uniform ivec2 u_resolution;
+uniform float u_lightReach;
+
+out vec2 uv;
+flat out vec4 segment;
+flat out vec3 emission;
+flat out float radius;
+
+void main() {
+    Light light = lights[gl_InstanceID];
+    segment  = light.segment;
+    emission = light.color.rgb * light.color.a;
+
+    // Points still cover a texel so rays can hit them
+    radius = max(light.params.x, 0.75f / float(min(u_resolution.x, u_resolution.y)));
+
+    vec2 low = min(segment.xy, segment.zw) - radius - u_lightReach;
+    vec2 high = max(segment.xy, segment.zw) + radius + u_lightReach;
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    uv = mix(low, high, corner);
+    gl_Position = vec4(uv * 2.0f - 1.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,76 @@
+#include"lights.h"
+
+#include<cmath>
+
+LightBuffer::LightBuffer() : capacity(1024) {
+	glGenBuffers(1, &ID);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(Light), NULL, GL_STREAM_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void LightBuffer::addPoint(float x, float y, const float color[3], float intensity) {
+	addSegment(x, y, x, y, 0.0f, color, intensity);
+}
+
+void LightBuffer::addDisc(float x, float y, float radius, const float color[3], float intensity) {
+	addSegment(x, y, x, y, radius, color, intensity);
+}
+
+void LightBuffer::addSegment(float startX, float startY, float endX, float endY, float radius, const float color[3], float intensity) {
+	Light light = { { startX, startY, endX, endY }, { color[0], color[1], color[2], intensity }, { radius, 0.0f, 0.0f, 0.0f } };
+	lights.push_back(light);
+}
+
+void LightBuffer::clearLights() {
+	lights.clear();
+}
+
+void LightBuffer::upload() {
+	if (lights.empty()) return;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+	while (lights.size() > capacity) capacity *= 2;
+
+	// Lights usually all move, so orphan the old storage instead of waiting for draws still reading it
+	glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(Light), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lights.size() * sizeof(Light), lights.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void LightBuffer::bindLightBuffer(GLuint binding) {
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, ID);
+}
+
+void LightBuffer::deleteLightBuffer() {
+	glDeleteBuffers(1, &ID);
+}
+
+void placeOrbitingLights(LightBuffer& lights, int count, float time) {
+	const int RING_COUNT = 4;
+	const float TAU = 6.28318531f;
+	lights.clearLights();
+
+	for (int i = 0; i < count; i++) {
+		const int ring = i % RING_COUNT;
+		const float radius = 0.15f + 0.08f * ring;
+		const float speed = (ring % 2 == 0 ? 0.2f : -0.15f) / (1.0f + ring);
+		const float angle = TAU * (float(i) / count + speed * time);
+		const float x = 0.5f + radius * cos(angle);
+		const float y = 0.5f + radius * sin(angle);
+
+		// Hue around the color wheel
+		const float hue = float(i) / count * 6.0f;
+		const float color[3] = {
+			std::fmin(std::fmax(std::fabs(hue - 3.0f) - 1.0f, 0.0f), 1.0f),
+			std::fmin(std::fmax(2.0f - std::fabs(hue - 2.0f), 0.0f), 1.0f),
+			std::fmin(std::fmax(2.0f - std::fabs(hue - 4.0f), 0.0f), 1.0f),
+		};
+
+		if (i % 4 == 3) {
+			const float tangentX = -sin(angle) * 0.015f, tangentY = cos(angle) * 0.015f;
+			lights.addSegment(x - tangentX, y - tangentY, x + tangentX, y + tangentY, 0.002f, color, 1.5f);
+		}
+		else lights.addDisc(x, y, 0.004f, color, 1.5f);
+	}
+}
@@ -0,0 +1,42 @@
+#ifndef LIGHTS_CLASS_H
+#define LIGHTS_CLASS_H
+
+#include<glad/glad.h>
+#include<cstddef>
+#include<vector>
+
+// One analytic light, laid out like the std430 struct in light.vert. Every light is a capsule:
+// points and discs are segments of length zero. Positions and radius are in canvas uv
+struct Light {
+	float segment[4];	// start.xy, end.xy
+	float color[4];		// rgb, intensity
+	float params[4];	// x: radius, 0 for a point
+};
+
+// Lights that live outside the canvas, mirrored into a shader storage buffer that light.vert
+// splats into the light textures every frame. Moving them never touches the canvas or the
+// distance field, so they can be animated freely
+class LightBuffer {
+public:
+	GLuint ID;
+	std::vector<Light> lights;
+
+	LightBuffer();
+
+	void addPoint(float x, float y, const float color[3], float intensity);
+	void addDisc(float x, float y, float radius, const float color[3], float intensity);
+	void addSegment(float startX, float startY, float endX, float endY, float radius, const float color[3], float intensity);
+	void clearLights();
+
+	void upload();		// copies every light to the GPU
+	void bindLightBuffer(GLuint binding);
+	void deleteLightBuffer();
+private:
+	size_t capacity;	// in lights
+};
+
+// Demo light set: count lights circling the canvas center on a few rings, mostly discs with a
+// segment every fourth light, placed for the given time in seconds
+void placeOrbitingLights(LightBuffer& lights, int count, float time);
+
+#endif
@@ -0,0 +1,110 @@
+#include"loader.h"
+
+#include<stb/stb_image.h>
+#include<iostream>
+
+bool SceneLoader::imageSize(const char* filename, int& width, int& height) {
+	int channels;
+	return stbi_info(filename, &width, &height, &channels) != 0;
+}
+
+SceneLoader::SceneLoader(const char* filename) : valid(false), width(0), height(0), filename(filename), pixelBuffer(0),
+	mappedPixels(NULL), decoded(false), decodeFailed(false), uploaded(false) {
+	if (!imageSize(filename, width, height)) {
+		std::cout << "Error: Could not read scene image " << filename << std::endl;
+		return;
+	}
+
+	// The buffer stays mapped while the worker fills it; no GL calls happen off this thread
+	glGenBuffers(1, &pixelBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)width * height * 4 * sizeof(float), NULL, GL_STREAM_DRAW);
+	mappedPixels = (float*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)width * height * 4 * sizeof(float),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (mappedPixels == NULL) {
+		std::cout << "Error: Could not map the scene upload buffer" << std::endl;
+		return;
+	}
+
+	valid = true;
+	thread = std::thread(&SceneLoader::decode, this);
+}
+
+void SceneLoader::decode() {
+	// GL textures start at the bottom row
+	stbi_set_flip_vertically_on_load_thread(1);
+
+	int imageWidth, imageHeight, channels;
+	const size_t texels = (size_t)width * height;
+
+	if (stbi_is_hdr(filename)) {
+		float* pixels = stbi_loadf(filename, &imageWidth, &imageHeight, &channels, 4);
+		if (pixels && imageWidth == width && imageHeight == height) {
+			for (size_t i = 0; i < texels; i++) {
+				const float* texel = pixels + i * 4;
+				const bool opaque = channels == 4 ? texel[3] > 0.0f : (texel[0] + texel[1] + texel[2]) > 0.0f;
+				mappedPixels[i * 4] = texel[0];
+				mappedPixels[i * 4 + 1] = texel[1];
+				mappedPixels[i * 4 + 2] = texel[2];
+				mappedPixels[i * 4 + 3] = opaque ? (channels == 4 ? texel[3] : 1.0f) : 0.0f;
+			}
+		}
+		else decodeFailed = true;
+		stbi_image_free(pixels);
+	}
+	else {
+		unsigned char* pixels = stbi_load(filename, &imageWidth, &imageHeight, &channels, 4);
+		if (pixels && imageWidth == width && imageHeight == height) {
+			for (size_t i = 0; i < texels; i++) {
+				const unsigned char* texel = pixels + i * 4;
+				const bool opaque = channels == 4 ? texel[3] > 0 : (texel[0] | texel[1] | texel[2]) != 0;
+				mappedPixels[i * 4] = texel[0] / 255.0f;
+				mappedPixels[i * 4 + 1] = texel[1] / 255.0f;
+				mappedPixels[i * 4 + 2] = texel[2] / 255.0f;
+				mappedPixels[i * 4 + 3] = opaque ? (channels == 4 ? texel[3] / 255.0f : 1.0f) : 0.0f;
+			}
+		}
+		else decodeFailed = true;
+		stbi_image_free(pixels);
+	}
+
+	decoded = true;
+}
+
+bool SceneLoader::upload(GLuint texture, bool wait) {
+	if (!valid || uploaded) return false;
+	if (!wait && !decoded) return false;
+
+	thread.join();
+	uploaded = true;
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	mappedPixels = NULL;
+
+	if (decodeFailed) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		std::cout << "Error: Could not decode scene image " << filename << std::endl;
+		return false;
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_FLOAT, (void*)0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return true;
+}
+
+void SceneLoader::deleteLoader() {
+	if (!valid) return;
+
+	if (thread.joinable()) thread.join();
+	if (mappedPixels) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	glDeleteBuffers(1, &pixelBuffer);
+	valid = false;
+}
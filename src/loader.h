@@ -0,0 +1,38 @@
+#ifndef LOADER_CLASS_H
+#define LOADER_CLASS_H
+
+#include<glad/glad.h>
+#include<atomic>
+#include<thread>
+
+// Loads a canvas from an image file (anything stb_image reads, HDR included) without holding
+// up startup: the pixels are decoded on a worker thread straight into a mapped pixel-unpack
+// buffer and uploaded to the canvas once ready. rgb becomes emitted light; alpha marks
+// occluders, and images without alpha treat every non-black texel as opaque
+class SceneLoader {
+public:
+	bool valid;
+	int width, height;
+
+	// Reads only the image header, so the canvas can be sized before the GL context exists
+	static bool imageSize(const char* filename, int& width, int& height);
+
+	SceneLoader(const char* filename);	// needs the GL context, starts decoding
+
+	// Uploads the image into the canvas texture once decoded, waiting for the decode when wait
+	// is set. Returns true on the call that uploaded
+	bool upload(GLuint texture, bool wait);
+	void deleteLoader();
+private:
+	const char* filename;
+	GLuint pixelBuffer;
+	float* mappedPixels;
+	std::atomic<bool> decoded;
+	bool decodeFailed;
+	bool uploaded;
+	std::thread thread;
+
+	void decode();
+};
+
+#endif
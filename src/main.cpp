@@ -3,19 +3,70 @@
 #include<glad/glad.h>
 #include<GLFW/glfw3.h>
 #include<stb/stb_image.h>
+#include<stb/stb_image_write.h>
 
 #include <cmath>
 #include <algorithm>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <string>
 
 #include"shader.h"
 #include"vao.h"
 #include"vbo.h"
 #include"ebo.h"
+#include"edt.h"
+#include"input.h"
+#include"timer.h"
+#include"scenes.h"
+#include"compare.h"
+#include"readback.h"
+#include"writer.h"
+#include"loader.h"
+#include"snapshot.h"
+#include"strokes.h"
+#include"extent.h"
+#include"lights.h"
 
 const int WINDOW_WIDTH  = 800;
 const int WINDOW_HEIGHT = 800;
 const char* WINDOW_NAME = "Radiance Cascades";
 
+// Resolution of the running session (window, canvas and every render target)
+int canvasWidth = WINDOW_WIDTH;
+int canvasHeight = WINDOW_HEIGHT;
+
+// Seed the first JFA step straight from the canvas alpha instead of running the uv pass
+const bool FUSED_JFA_SEED = true;
+// Write the R16F distance field from the last JFA step (MRT) instead of running the dist pass
+const bool FUSED_JFA_DIST = true;
+// Let rc.frag compute distances on the fly from the JFA seeds, dropping the distance field entirely
+const bool DISTANCE_FROM_SEED = false;
+// Store the distance field in canvas snapshots, so restoring one skips the Jump Flood
+const bool SNAPSHOT_DISTANCE_FIELD = true;
+// Levels of the min-distance pyramid the upper cascades jump across empty tiles with, 0 disables it
+const int DISTANCE_MIP_LEVELS = 5;
+// Let rays cross empty tiles of a per-tile occupancy bitmask in one step
+const bool OCCUPANCY_MASK = true;
+// Texels per occupancy tile side, the work group size of occupancy.comp
+const int OCCUPANCY_TILE_SIZE = 8;
+// Store the canvas as sRGB and write the final image through an sRGB framebuffer, so the
+// cascades transport light in linear space with the gamma conversion done by the texture and
+// blending hardware; off, colors are used as stored (reveals banding in dim falloffs when on,
+// and clamps HDR emitters to 1)
+const bool SRGB_CANVAS = false;
+// Skip the rays of cascade probes buried in paint, see raymarch() in rc.frag
+const bool CULL_BURIED_PROBES = true;
+// How far (in canvas uv) the light distance texture reaches around each analytic light; while
+// lights are on, rays step at most this far at a time through space they don't cover
+const float LIGHT_REACH = 0.05f;
+// Fraction of the incoming light black paint reflects while the bounce feedback is on; below 1
+// so the bounces feeding back into each other converge
+const float BOUNCE_ALBEDO = 0.6f;
+
 GLfloat vertices[] = {
 	// positions		// RGBa
 	-1.0f, -1.0f, 0.0f,	0.0f, 1.0f, 0.5f, 0.0f,	// 0
@@ -33,12 +84,89 @@ float mouseX = 0.0f, mouseY = 0.0f;
 float lastMouseX = 0.0f, lastMouseY = 0.0f;
 int mouseClicked = 0;
 
+// Temporal reuse of upper cascades: a level is only re-evaluated right away for changes that reach
+// its rays, otherwise it catches up every 2^k frames (staggered so at most one upper level
+// refreshes per frame), blended with its history while the radiance is still changing
+bool temporalCascades = true;
+const float temporalBlend = 0.5f; // weight of the freshly evaluated cascade
+
+// Jump flood schedules, cycled at runtime with J (each switch prints a pass count, traffic
+// and accuracy report against an exact distance transform of the canvas)
+enum JfaMode { JFA_STANDARD, JFA_ONE_PLUS, JFA_PLUS_ONE, JFA_PLUS_TWO, JFA_HALF_RES, JFA_MODE_COUNT };
+const char* JFA_MODE_NAMES[] = { "JFA", "1+JFA", "JFA+1", "JFA+2", "Half-res JFA + refinement" };
+JfaMode jfaMode = JFA_STANDARD;
+bool jfaReportPending = false;
+
+struct JfaPass {
+	int offset;		// in texels of the pass resolution
+	bool halfRes;
+};
+
+// passes is log2 of the largest canvas side, the number of steps of the standard schedule
+std::vector<JfaPass> jfaSchedule(JfaMode mode, int passes) {
+	std::vector<JfaPass> schedule;
+
+	if (mode == JFA_HALF_RES) {
+		for (int i = passes - 2; i >= 0; i--) schedule.push_back({ 1 << i, true });
+		schedule.push_back({ 1, false }); // full-res refinement, also re-seeds from the canvas
+		return schedule;
+	}
+
+	if (mode == JFA_ONE_PLUS) schedule.push_back({ 1, false });
+	for (int i = passes - 1; i >= 0; i--) schedule.push_back({ 1 << i, false });
+	if (mode == JFA_PLUS_TWO) schedule.push_back({ 2, false });
+	if (mode == JFA_PLUS_ONE || mode == JFA_PLUS_TWO) schedule.push_back({ 1, false });
+	return schedule;
+}
+
+// Approximate memory traffic of a schedule: nine RGBA32F fetches and one RGBA32F write per texel
+// and pass, nine more canvas fetches for the refinement pass and the R16F distance write
+double jfaTrafficBytes(const std::vector<JfaPass>& schedule, int width, int height) {
+	double bytes = 0.0;
+	for (size_t i = 0; i < schedule.size(); i++) {
+		const double texels = schedule[i].halfRes ? double(width / 2) * (height / 2) : double(width) * height;
+		const bool refinement = i > 0 && schedule[i - 1].halfRes && !schedule[i].halfRes;
+		bytes += texels * ((refinement ? 18 : 9) * 16 + 16);
+	}
+	return bytes + double(width) * height * 2;
+}
+
+void reportJfa(const std::vector<JfaPass>& schedule, GLuint canvasTexture, GLuint seedTexture, int width, int height) {
+	std::vector<float> canvas(width * height * 4), seeds(width * height * 4);
+
+	glActiveTexture(GL_TEXTURE5);
+	glBindTexture(GL_TEXTURE_2D, canvasTexture);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, canvas.data());
+	glBindTexture(GL_TEXTURE_2D, seedTexture);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, seeds.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	SeedError error = measureSeedError(canvas, seeds, width, height);
+	std::cout << JFA_MODE_NAMES[jfaMode] << ": " << schedule.size() << " passes, ~"
+		<< jfaTrafficBytes(schedule, width, height) / (1024.0 * 1024.0) << " MB per rebuild, max error "
+		<< error.maxError << " px, mean error " << error.meanError << " px, "
+		<< error.wrongTexels << " texels off by more than half a texel" << std::endl;
+}
+
+// Signed distance field (toggle with S): a second flood of the inverted seeds gives the distance
+// to the nearest empty texel, so rays can tell when their interval starts inside an occluder
+bool signedDistanceField = false;
+
 // GLFW mouse functions
 
+// Cursor positions reported since the last frame while painting (x, y pairs in NDC), so fast
+// strokes keep every sample instead of only the position at frame time
+std::vector<float> cursorSamples;
+
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
-	mouseX = (static_cast<float>(xpos) / WINDOW_WIDTH) * 2.0f - 1.0f;
-	mouseY = (static_cast<float>(ypos) / WINDOW_HEIGHT) * 2.0f - 1.0f;
+	mouseX = (static_cast<float>(xpos) / canvasWidth) * 2.0f - 1.0f;
+	mouseY = (static_cast<float>(ypos) / canvasHeight) * 2.0f - 1.0f;
 	mouseY = -mouseY;
+
+	if (mouseClicked != 0) {
+		cursorSamples.push_back(mouseX);
+		cursorSamples.push_back(mouseY);
+	}
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
@@ -48,51 +176,190 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 	else if (button == GLFW_MOUSE_BUTTON_RIGHT) {
 		mouseClicked = 2 * (action == GLFW_PRESS);
 	}
+	else if (button == GLFW_MOUSE_BUTTON_MIDDLE) {
+		mouseClicked = 3 * (action == GLFW_PRESS);
+	}
+}
+
+// GLFW key functions
+
+// Canvas snapshots: F5 saves the canvas to snapshotFile, F9 restores it
+std::string snapshotFile = "canvas.rcsnap";
+bool snapshotSavePending = false;
+bool snapshotLoadPending = false;
+
+// The Jump Flood only reruns when the canvas or its settings changed
+bool distanceFieldDirty = true;
+
+// Ctrl+Z removes the last brush stroke
+bool undoPending = false;
+
+// Analytic lights circling the canvas (toggle with L, --lights <n> sets the count)
+const int DEFAULT_ORBITING_LIGHTS = 256;
+int orbitingLights = 0;
+
+// Indirect light: every ray hit also reflects last frame's radiance (toggle with B, --bounce)
+bool bounceFeedback = false;
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	if (action != GLFW_PRESS) return;
+
+	if (key == GLFW_KEY_T) {
+		temporalCascades = !temporalCascades;
+		std::cout << "Temporal cascades: " << (temporalCascades ? "on" : "off") << std::endl;
+	}
+	else if (key == GLFW_KEY_S) {
+		signedDistanceField = !signedDistanceField;
+		std::cout << "Signed distance field: " << (signedDistanceField ? "on" : "off") << std::endl;
+		distanceFieldDirty = true;
+	}
+	else if (key == GLFW_KEY_J) {
+		jfaMode = JfaMode((jfaMode + 1) % JFA_MODE_COUNT);
+		jfaReportPending = true;
+		distanceFieldDirty = true;
+	}
+	else if (key == GLFW_KEY_Z && (mods & GLFW_MOD_CONTROL)) {
+		undoPending = true;
+	}
+	else if (key == GLFW_KEY_F5) {
+		snapshotSavePending = true;
+	}
+	else if (key == GLFW_KEY_F9) {
+		snapshotLoadPending = true;
+	}
+	else if (key == GLFW_KEY_L) {
+		orbitingLights = orbitingLights ? 0 : DEFAULT_ORBITING_LIGHTS;
+		std::cout << "Orbiting lights: " << orbitingLights << std::endl;
+	}
+	else if (key == GLFW_KEY_B) {
+		bounceFeedback = !bounceFeedback;
+		std::cout << "Bounce feedback: " << (bounceFeedback ? "on" : "off") << std::endl;
+	}
 }
 
 // FPS counter
 double lastTime = glfwGetTime();
 int frameCount = 0;
+int elidedCascadeCount = 0;
 
-void updateFPS() {
+void updateFPS(int elidedCascades) {
 	double currentTime = glfwGetTime();
 	frameCount++;
+	elidedCascadeCount += elidedCascades;
 
 	// Calculate and output FPS every 1 second
 	if (currentTime - lastTime >= 1.0) {
-		std::cout << "FPS: " << frameCount << std::endl;
+		std::cout << "FPS: " << frameCount << ", cascade passes elided per frame: " << double(elidedCascadeCount) / frameCount << std::endl;
 		frameCount = 0;
+		elidedCascadeCount = 0;
 		lastTime = currentTime;
 	}
 }
 
-int main() {
+// Render passes timed by the benchmark
+enum RenderPass { PASS_BRUSH, PASS_OCCUPANCY, PASS_UV, PASS_JFA, PASS_DISTANCE, PASS_PYRAMID, PASS_LIGHTS, PASS_CASCADES, PASS_COUNT };
+const char* RENDER_PASS_NAMES[] = { "brush", "occupancy", "uv", "jfa", "distance", "pyramid", "lights", "cascades" };
+
+struct SessionTimings {
+	long frames = 0;
+	double frameMs = 0.0;			// wall time including glFinish, summed over the frames
+	double minFrameMs = 0.0;
+	double maxFrameMs = 0.0;
+	std::vector<double> passMs;		// GPU time per RenderPass, summed over the frames
+	double elidedCascades = 0.0;		// cascade passes skipped for the scene extent, summed over the frames
+	double cascadeRays = 0.0;		// rays the rendered cascade passes would cast without culling, summed
+	double culledRays = 0.0;		// of which belonged to culled probes, summed over the frames
+};
+
+// Options of one run of the renderer; the interactive app is a single session, the benchmark
+// runs one per scene and configuration
+struct SessionOptions {
+	int width = WINDOW_WIDTH;
+	int height = WINDOW_HEIGHT;
+	bool headless = false;			// hidden window, no vsync
+	long maxFrames = -1;			// -1 runs until the window is closed
+	long warmupFrames = 0;			// frames left out of the timings
+	const char* recordFile = NULL;
+	const char* replayFile = NULL;
+	const Scene* scene = NULL;		// initial canvas content
+	const char* sceneFile = NULL;		// image loaded as the canvas, which takes its size
+	const char* snapshotFile = NULL;	// snapshot restored at startup (if it exists) and saved to with F5
+	bool rebuildDistanceField = false;	// rerun the Jump Flood every frame, even on an unchanged canvas
+	SessionTimings* timings = NULL;	// filled with the timings of the measured frames when set
+	FrameReadback::Callback onFrame;	// receives every rendered frame a few frames late when set
+};
+
+int runSession(const SessionOptions& options) {
+	canvasWidth = options.width;
+	canvasHeight = options.height;
+	if (options.sceneFile && !SceneLoader::imageSize(options.sceneFile, canvasWidth, canvasHeight)) {
+		std::cout << "Error: Could not read scene image " << options.sceneFile << std::endl;
+		return -1;
+	}
+	mouseX = mouseY = lastMouseX = lastMouseY = 0.0f;
+	mouseClicked = 0;
+	cursorSamples.clear();
+	distanceFieldDirty = true;
+	snapshotSavePending = snapshotLoadPending = undoPending = false;
+
+	// A snapshot sizes the canvas like a scene image does
+	if (options.snapshotFile) {
+		snapshotFile = options.snapshotFile;
+		snapshotLoadPending = snapshotSize(options.snapshotFile, canvasWidth, canvasHeight);
+	}
+
+	long maxFrames = options.maxFrames;
+	std::unique_ptr<InputReplay> replay;
+	if (options.replayFile) {
+		replay.reset(new InputReplay(options.replayFile));
+		if (!replay->valid) return -1;
+		if (maxFrames < 0) maxFrames = long(replay->lastFrame()) + 1;
+	}
+	std::unique_ptr<InputRecorder> recorder;
+	if (options.recordFile) {
+		recorder.reset(new InputRecorder(options.recordFile));
+	}
 
 	// Initialize GLFW window, GLAD, and OpenGL
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	GLFWwindow* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_NAME, NULL, NULL);
+	glfwWindowHint(GLFW_VISIBLE, options.headless ? GLFW_FALSE : GLFW_TRUE);
+	glfwWindowHint(GLFW_SRGB_CAPABLE, SRGB_CANVAS ? GLFW_TRUE : GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(canvasWidth, canvasHeight, WINDOW_NAME, NULL, NULL);
 	if (window == NULL) {
 		std::cout << "Failed to create GLFW window" << std::endl;
 		glfwTerminate();
 		return -1;
 	}
-	glfwSetCursorPosCallback(window, mouse_callback);
-	glfwSetMouseButtonCallback(window, mouse_button_callback);
+	if (!replay) {
+		glfwSetCursorPosCallback(window, mouse_callback);
+		glfwSetMouseButtonCallback(window, mouse_button_callback);
+	}
+	glfwSetKeyCallback(window, key_callback);
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
 	glfwMakeContextCurrent(window);
 	gladLoadGL();
-	glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+	if (options.headless) glfwSwapInterval(0);
+	glViewport(0, 0, canvasWidth, canvasHeight);
+
+	// Decoding a scene image overlaps with compiling the shaders and the first frames
+	std::unique_ptr<SceneLoader> sceneLoader;
+	if (options.sceneFile) {
+		sceneLoader.reset(new SceneLoader(options.sceneFile));
+	}
 
 	// Initialize shader program
-	Shader drawShader("draw.vert", "draw.frag");
 	Shader uvShader("uv.vert", "uv.frag");
 	Shader jfaShader("jfa.vert", "jfa.frag");
 	Shader distShader("dist.vert", "dist.frag");
 	Shader rcShader("rc.vert", "rc.frag");
 	Shader renderShader("render.vert", "render.frag");
+	Shader strokeShader("stroke.vert", "stroke.frag");
+	Shader mipShader("mip.vert", "mip.frag");
+	Shader occupancyShader("occupancy.comp");
+	Shader lightShader("light.vert", "light.frag");
 
 	// Create VAO, VBO, and EBO for triangles
 	VAO VAO;
@@ -114,129 +381,361 @@ int main() {
 	glBindTexture(GL_TEXTURE_2D, canvasTexture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+	// Half floats halve the canvas fetches of RGBA32F and still keep the emitters above 1 that HDR
+	// scene images and snapshots carry; an sRGB canvas has eight bits and clamps them
+	const GLenum canvasFormat = SRGB_CANVAS ? GL_SRGB8_ALPHA8 : GL_RGBA16F;
+	glTexImage2D(GL_TEXTURE_2D, 0, canvasFormat, canvasWidth, canvasHeight, 0, GL_RGBA, GL_FLOAT, NULL);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, canvasTexture, 0);
 	auto fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 	if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
 		std::cout << "Error: Canvas framebuffer is not complete!" << std::endl;
 	}
 
-	// Create FBO and texture to save the canvas uv map
-	GLuint uvMapFBO, uvMapTexture;
-	glGenFramebuffers(1, &uvMapFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, uvMapFBO);
-	glGenTextures(1, &uvMapTexture);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, uvMapTexture);
+	// Start from an empty canvas, or a canned scene, with the grid painted once here
+	std::vector<float> canvasPixels(canvasWidth * canvasHeight * 4, 0.0f);
+	if (options.scene) options.scene->paint(canvasPixels, canvasWidth, canvasHeight);
+	paintGrid(canvasPixels, canvasWidth, canvasHeight);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, canvasWidth, canvasHeight, GL_RGBA, GL_FLOAT, canvasPixels.data());
+
+	// The canvas without brush strokes (empty, a scene, an image or a snapshot); undoing a stroke
+	// copies it back into the canvas and rasterizes the remaining strokes on top
+	GLuint canvasBaseTexture;
+	glGenTextures(1, &canvasBaseTexture);
+	glBindTexture(GL_TEXTURE_2D, canvasBaseTexture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, uvMapTexture, 0);
-	fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-	if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
-		std::cout << "Error: UV map framebuffer is not complete!" << std::endl;
+	glTexImage2D(GL_TEXTURE_2D, 0, canvasFormat, canvasWidth, canvasHeight, 0, GL_RGBA, GL_FLOAT, canvasPixels.data());
+	glBindTexture(GL_TEXTURE_2D, canvasTexture);
+	canvasPixels = std::vector<float>();
+
+	// Brush strokes, kept as capsules in canvas uv and rasterized as instanced quads
+	StrokeBuffer strokes;
+	size_t rasterizedCapsules = 0;
+	int lastMouseClicked = 0;
+	const float brushRadius = 0.5f * sqrt(0.25f / std::min(canvasWidth, canvasHeight));
+
+	// The emission layer: strokes of the middle mouse button that only emit light. They never
+	// enter the canvas, so painting them doesn't rebuild the distance field. Undo walks both
+	// layers in painting order
+	StrokeBuffer emissionStrokes;
+	std::vector<bool> undoEmissionLayer;
+
+	// Analytic lights and the emission layer, splatted by instanced draws with two render targets
+	// into an emission texture (unit 8) and a texture of the distance to the nearest emitter (unit 9)
+	// whenever either changes
+	LightBuffer lights;
+	bool lightsShown = false;
+
+	GLuint lightFBO, lightTextures[2];
+	glGenFramebuffers(1, &lightFBO);
+	glGenTextures(2, lightTextures);
+	glBindFramebuffer(GL_FRAMEBUFFER, lightFBO);
+	for (int i = 0; i < 2; i++) {
+		glActiveTexture(GL_TEXTURE8 + i);
+		glBindTexture(GL_TEXTURE_2D, lightTextures[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		if (i == 0) glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, canvasWidth, canvasHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+		else glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, canvasWidth, canvasHeight, 0, GL_RED, GL_FLOAT, NULL);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, lightTextures[i], 0);
+	}
+	GLenum lightBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, lightBuffers);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "Error: Light framebuffer is not complete!" << std::endl;
 	}
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, canvasTexture);
 
-	// Create FBOs and texture for the jfa algorithm
-	GLuint jfaFramebuffers[2];
-	glGenFramebuffers(2, jfaFramebuffers);
-	GLuint jfaFBO_A = jfaFramebuffers[0];
-	GLuint jfaFBO_B = jfaFramebuffers[1];
-	glBindFramebuffer(GL_FRAMEBUFFER, jfaFBO_A);
-	GLuint jfaTexture;
-	glGenTextures(1, &jfaTexture);
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, jfaTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, jfaTexture, 0);
-	fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-	if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
-		std::cout << "Error: JFA framebuffer A is not complete!" << std::endl;
+	// While the bounce feedback is on, level 0 renders into one of these instead of the default
+	// framebuffer and the other one (last frame's, unit 10) is what ray hits reflect
+	bool bounceShown = false;
+	int feedbackIndex = 0;
+
+	GLuint feedbackFBOs[2], feedbackTextures[2];
+	glGenFramebuffers(2, feedbackFBOs);
+	glGenTextures(2, feedbackTextures);
+	glActiveTexture(GL_TEXTURE10);
+	for (int i = 0; i < 2; i++) {
+		glBindTexture(GL_TEXTURE_2D, feedbackTextures[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, canvasWidth, canvasHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBOs[i]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackTextures[i], 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Error: Feedback framebuffer " << i << " is not complete!" << std::endl;
+		}
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, jfaFBO_B);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, canvasTexture);
+
+	// Create FBO and texture to save the canvas uv map (only needed when the seeding isn't fused)
+	GLuint uvMapFBO = 0, uvMapTexture = 0;
+	if (!FUSED_JFA_SEED) {
+		glGenFramebuffers(1, &uvMapFBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, uvMapFBO);
+		glGenTextures(1, &uvMapTexture);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, uvMapTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, canvasWidth, canvasHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, uvMapTexture, 0);
+		fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Error: UV map framebuffer is not complete!" << std::endl;
+		}
+	}
+
+	// Create FBOs and textures for the jfa algorithm: a full-resolution ping-pong pair (0, 1)
+	// and a half-resolution pair (2, 3) for the coarse schedule, and the same again (4-7) for
+	// the flood of the inverted seeds that makes the distance field signed
+	GLuint jfaFramebuffers[8], jfaTextures[8];
+	glGenFramebuffers(8, jfaFramebuffers);
+	glGenTextures(8, jfaTextures);
 	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, jfaTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, jfaTexture, 0);
-	fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-	if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
-		std::cout << "Error: JFA framebuffer B is not complete!" << std::endl;
+	for (int i = 0; i < 8; i++) {
+		const bool halfRes = (i % 4) >= 2;
+		const int jfaWidth = halfRes ? canvasWidth / 2 : canvasWidth;
+		const int jfaHeight = halfRes ? canvasHeight / 2 : canvasHeight;
+
+		glBindFramebuffer(GL_FRAMEBUFFER, jfaFramebuffers[i]);
+		glBindTexture(GL_TEXTURE_2D, jfaTextures[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, jfaWidth, jfaHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, jfaTextures[i], 0);
+		fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Error: JFA framebuffer " << i << " is not complete!" << std::endl;
+		}
 	}
 
-	// Create FBO and texture to save the distance field texture
-	GLuint distanceFieldFBO, distanceFieldTexture;
-	glGenFramebuffers(1, &distanceFieldFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, distanceFieldFBO);
-	glGenTextures(1, &distanceFieldTexture);
-	glActiveTexture(GL_TEXTURE3);
-	glBindTexture(GL_TEXTURE_2D, distanceFieldTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+	// Create FBO and texture to save the distance field texture, or attach it as a second
+	// target of the last JFA step when the conversion is fused into it
+	GLuint distanceFieldFBO = 0, distanceFieldTexture = 0, jfaFinalFBO = 0;
+	if (!DISTANCE_FROM_SEED) {
+		glGenTextures(1, &distanceFieldTexture);
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, distanceFieldTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		if (FUSED_JFA_DIST) {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, canvasWidth, canvasHeight, 0, GL_RED, GL_FLOAT, NULL);
+
+			glGenFramebuffers(1, &jfaFinalFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER, jfaFinalFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, jfaTextures[0], 0);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, distanceFieldTexture, 0);
+			GLenum jfaFinalBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+			glDrawBuffers(2, jfaFinalBuffers);
+			fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+			if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
+				std::cout << "Error: JFA final framebuffer is not complete!" << std::endl;
+			}
+		}
+		else {
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, canvasWidth, canvasHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+
+			glGenFramebuffers(1, &distanceFieldFBO);
+			glBindFramebuffer(GL_FRAMEBUFFER, distanceFieldFBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, distanceFieldTexture, 0);
+			fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+			if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
+				std::cout << "Error: Distance field framebuffer is not complete!" << std::endl;
+			}
+		}
+	}
 
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, distanceFieldTexture, 0);
-	fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-	if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
-		std::cout << "Error: Distance field framebuffer is not complete!" << std::endl;
+	// Each level of the distance pyramid holds the smallest distance of the 2x2 texels below it,
+	// so a coarse texel above the hit threshold proves its whole tile is free of occluders. Levels
+	// stop where the canvas no longer halves evenly, keeping every tile aligned with the one below
+	int distanceMipLevels = 0;
+	GLuint distanceMipFBO = 0;
+	if (!DISTANCE_FROM_SEED) {
+		while (distanceMipLevels < DISTANCE_MIP_LEVELS && ((canvasWidth >> distanceMipLevels) & 1) == 0 && ((canvasHeight >> distanceMipLevels) & 1) == 0) {
+			distanceMipLevels++;
+		}
+
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, distanceFieldTexture);
+		for (int level = 1; level <= distanceMipLevels; level++) {
+			if (FUSED_JFA_DIST) glTexImage2D(GL_TEXTURE_2D, level, GL_R16F, canvasWidth >> level, canvasHeight >> level, 0, GL_RED, GL_FLOAT, NULL);
+			else glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA32F, canvasWidth >> level, canvasHeight >> level, 0, GL_RGBA, GL_FLOAT, NULL);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, distanceMipLevels);
+		if (distanceMipLevels > 0) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+			glGenFramebuffers(1, &distanceMipFBO);
+		}
 	}
 
-	// Create FBOs and texture for the radiance cascade algorithm
-	GLuint rcFramebuffers[2];
-	glGenFramebuffers(2, rcFramebuffers);
-	GLuint rcFBO_A = rcFramebuffers[0];
-	GLuint rcFBO_B = rcFramebuffers[1];
+	// One bit per OCCUPANCY_TILE_SIZE square tile of the canvas, rows padded to whole 32-bit
+	// words, kept on shader storage binding 1 for occupancy.comp to write and rc.frag to read
+	const int occupancyTilesX = (canvasWidth + OCCUPANCY_TILE_SIZE - 1) / OCCUPANCY_TILE_SIZE;
+	const int occupancyTilesY = (canvasHeight + OCCUPANCY_TILE_SIZE - 1) / OCCUPANCY_TILE_SIZE;
+	GLuint occupancyBuffer = 0;
+	if (OCCUPANCY_MASK) {
+		glGenBuffers(1, &occupancyBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, occupancyBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, (occupancyTilesX + 31) / 32 * occupancyTilesY * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, occupancyBuffer);
+	}
+	std::unique_ptr<OccupiedExtent> occupiedExtent;
+	if (OCCUPANCY_MASK) occupiedExtent.reset(new OccupiedExtent(occupancyTilesX, occupancyTilesY, OCCUPANCY_TILE_SIZE, canvasWidth, canvasHeight));
 
-	GLuint rcTextures[2];
-	glGenTextures(2, rcTextures);
-	GLuint rcTexture_A = rcTextures[0];
-	GLuint rcTexture_B = rcTextures[1];
+	// Rebuilds the distance pyramid from level 0, restricting sampling to the level below each
+	// target so reading and writing never touch the same level
+	auto buildDistancePyramid = [&]() {
+		if (distanceMipLevels == 0) return;
 
-	glBindTexture(GL_TEXTURE_2D, rcTexture_A);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		mipShader.activateShader();
+		glUniform1i(glGetUniformLocation(mipShader.ID, "u_distanceFieldTexture"), 3);
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, distanceFieldTexture);
+		glBindFramebuffer(GL_FRAMEBUFFER, distanceMipFBO);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, rcFBO_A);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rcTexture_A, 0);
-	fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-	if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
-		std::cout << "Error: RC framebuffer A is not complete!" << std::endl;
-	}
+		for (int level = 1; level <= distanceMipLevels; level++) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, distanceFieldTexture, level);
+			glViewport(0, 0, canvasWidth >> level, canvasHeight >> level);
 
-	glBindTexture(GL_TEXTURE_2D, rcTexture_B);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			VAO.bindVAO();
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+			VAO.unbindVAO();
+		}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, rcFBO_B);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rcTexture_B, 0);
-	fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-	if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
-		std::cout << "Error: RC framebuffer B is not complete!" << std::endl;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, distanceMipLevels);
+		glViewport(0, 0, canvasWidth, canvasHeight);
+	};
+
+	// Radiance cascade parameters
+	const int baseRayCount = 16;
+	const float diagonalLength = sqrt(canvasWidth * canvasWidth + canvasHeight * canvasHeight);
+	const int cascadeCount = int(ceil(log(diagonalLength) / log(baseRayCount))) + 1;
+
+	// Number of cascade levels that can reach paint inside the given box from some probe. Level
+	// i > 0 starts its rays 5 * baseRayCount^(i-1) texels out (intervalStart in rc.frag), so levels
+	// starting beyond the farthest canvas point from the box only ever miss. Level cascadeCount
+	// is never merged into the one below it and is always left out
+	auto reachableCascades = [&](int minX, int minY, int maxX, int maxY) {
+		if (minX >= maxX || minY >= maxY) return 1;
+
+		const double reachX = std::max(maxX, canvasWidth - minX);
+		const double reachY = std::max(maxY, canvasHeight - minY);
+		const double reach = sqrt(reachX * reachX + reachY * reachY);
+
+		int count = 1;
+		while (count < cascadeCount && 5.0 * pow(baseRayCount, count - 1) <= reach) count++;
+		return count;
+	};
+	const int canvasCascades = reachableCascades(0, 0, canvasWidth, canvasHeight);
+	int activeCascades = canvasCascades;
+	int lastActiveCascades = 0;
+
+	// Size in texels of a light, the extent of the change moving it makes to the radiance
+	auto lightSize = [&](const float segment[4], float radius) {
+		const float lengthX = (segment[2] - segment[0]) * canvasWidth;
+		const float lengthY = (segment[3] - segment[1]) * canvasHeight;
+		return std::sqrt(lengthX * lengthX + lengthY * lengthY) + 2.0f * radius * std::max(canvasWidth, canvasHeight);
+	};
+
+	// Upper levels a change doesn't reach keep their history and are stale until a refresh has
+	// caught them up with it, or with a level above them that was refreshed meanwhile
+	std::vector<bool> cascadeStale(cascadeCount, false);
+
+	// Create FBOs and textures for the radiance cascade algorithm, one per upper level so
+	// each level keeps its history across frames (level 0 renders to the default framebuffer).
+	// Only levels up to cascadeCount - 1 are ever enabled, see reachableCascades
+	std::vector<GLuint> rcFramebuffers(cascadeCount);
+	std::vector<GLuint> rcTextures(cascadeCount);
+	glGenFramebuffers(cascadeCount - 1, rcFramebuffers.data() + 1);
+	glGenTextures(cascadeCount - 1, rcTextures.data() + 1);
+	glActiveTexture(GL_TEXTURE4);
+
+	for (int i = 1; i < cascadeCount; i++) {
+		glBindTexture(GL_TEXTURE_2D, rcTextures[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, rcFramebuffers[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, canvasWidth, canvasHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, rcTextures[i], 0);
+		fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Error: RC framebuffer " << i << " is not complete!" << std::endl;
+		}
+		glClear(GL_COLOR_BUFFER_BIT);
 	}
 
 	glBindTexture(GL_TEXTURE_2D, 0);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+	// Ray direction tables for rc.frag, so it never evaluates cos/sin per ray. Cascade c casts
+	// baseRayCount^(c+1) rays, too many to list for the upper levels, so each ray angle is split
+	// into the angle of its group of baseRayCount rays plus its rotation within the group: a
+	// cascade stores the baseRayCount rotations, then one direction per group (x = cos, y = -sin)
+	std::vector<float> rayDirections;
+	std::vector<GLint> rayDirectionOffsets(cascadeCount);
+	for (int c = 0; c < cascadeCount; c++) {
+		const int groupCount = int(pow(baseRayCount, c));
+		const double angleStep = 2.0 * 3.14159265358979323846 / (double(groupCount) * baseRayCount);
+		rayDirectionOffsets[c] = GLint(rayDirections.size() / 2);
+
+		for (int i = 0; i < baseRayCount; i++) {
+			rayDirections.push_back(float(cos(angleStep * (i + 0.5))));
+			rayDirections.push_back(float(-sin(angleStep * (i + 0.5))));
+		}
+		for (int group = 0; group < groupCount; group++) {
+			rayDirections.push_back(float(cos(angleStep * double(group) * baseRayCount)));
+			rayDirections.push_back(float(-sin(angleStep * double(group) * baseRayCount)));
+		}
+	}
+
+	GLuint rayDirectionBuffer;
+	glGenBuffers(1, &rayDirectionBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, rayDirectionBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, rayDirections.size() * sizeof(float), rayDirections.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, rayDirectionBuffer);
+
+	// Atomic counter rc.frag counts culled probes in on measured benchmark frames
+	GLuint culledProbeCounter;
+	const GLuint zeroCount = 0;
+	glGenBuffers(1, &culledProbeCounter);
+	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, culledProbeCounter);
+	glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), &zeroCount, GL_DYNAMIC_READ);
+	glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+	glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, culledProbeCounter);
+
 	// Creating uniforms
-	GLuint u_resolution_draw = glGetUniformLocation(drawShader.ID, "u_resolution");
-	GLuint u_mousePos_draw = glGetUniformLocation(drawShader.ID, "u_mousePos");
-	GLuint u_lastMousePos_draw = glGetUniformLocation(drawShader.ID, "u_lastMousePos");
-	GLuint u_mouseClick_draw = glGetUniformLocation(drawShader.ID, "u_mouseClicked");
-	GLuint u_canvasTexture_draw = glGetUniformLocation(drawShader.ID, "u_canvasTexture");
+	GLuint u_firstCapsule_stroke = glGetUniformLocation(strokeShader.ID, "u_firstCapsule");
 
 	GLuint u_resolution_uv = glGetUniformLocation(uvShader.ID, "u_resolution");
 	GLuint u_canvasTexture_uv = glGetUniformLocation(uvShader.ID, "u_canvasTexture");
 
 	GLuint u_resolution_jfa = glGetUniformLocation(jfaShader.ID, "u_resolution");
 	GLuint u_inputTexture_jfa = glGetUniformLocation(jfaShader.ID, "u_inputTexture");
+	GLuint u_canvasTexture_jfa = glGetUniformLocation(jfaShader.ID, "u_canvasTexture");
 	GLuint u_offset_jfa = glGetUniformLocation(jfaShader.ID, "u_offset");
+	GLuint u_seedFromCanvas_jfa = glGetUniformLocation(jfaShader.ID, "u_seedFromCanvas");
+	GLuint u_refineWithCanvas_jfa = glGetUniformLocation(jfaShader.ID, "u_refineWithCanvas");
+	GLuint u_invertSeeds_jfa = glGetUniformLocation(jfaShader.ID, "u_invertSeeds");
+	GLuint u_signedDistance_jfa = glGetUniformLocation(jfaShader.ID, "u_signedDistance");
+	GLuint u_exteriorSeedTexture_jfa = glGetUniformLocation(jfaShader.ID, "u_exteriorSeedTexture");
 
 	GLuint u_jfaTexture_dist = glGetUniformLocation(distShader.ID, "u_jfaTexture");
+	GLuint u_jfaInteriorTexture_dist = glGetUniformLocation(distShader.ID, "u_jfaInteriorTexture");
+	GLuint u_signedField_dist = glGetUniformLocation(distShader.ID, "u_signedField");
 
 	GLuint u_resolution_rc = glGetUniformLocation(rcShader.ID, "u_resolution");
 	GLuint u_mousePos_rc = glGetUniformLocation(rcShader.ID, "u_mousePos");
@@ -246,155 +745,917 @@ int main() {
 	GLuint u_cascadeCount_rc = glGetUniformLocation(rcShader.ID, "u_cascadeCount");
 	GLuint u_canvasTexture_rc = glGetUniformLocation(rcShader.ID, "u_canvasTexture");
 	GLuint u_distanceFieldTexture_rc = glGetUniformLocation(rcShader.ID, "u_distanceFieldTexture");
+	GLuint u_jfaTexture_rc = glGetUniformLocation(rcShader.ID, "u_jfaTexture");
+	GLuint u_distanceFromSeed_rc = glGetUniformLocation(rcShader.ID, "u_distanceFromSeed");
+	GLuint u_jfaInteriorTexture_rc = glGetUniformLocation(rcShader.ID, "u_jfaInteriorTexture");
+	GLuint u_signedField_rc = glGetUniformLocation(rcShader.ID, "u_signedField");
+	GLuint u_distanceMipLevels_rc = glGetUniformLocation(rcShader.ID, "u_distanceMipLevels");
+	GLuint u_occupancyTileSize_rc = glGetUniformLocation(rcShader.ID, "u_occupancyTileSize");
+	GLuint u_rayDirectionOffset_rc = glGetUniformLocation(rcShader.ID, "u_rayDirectionOffset");
+	GLuint u_cullProbes_rc = glGetUniformLocation(rcShader.ID, "u_cullProbes");
+	GLuint u_lightTexture_rc = glGetUniformLocation(rcShader.ID, "u_lightTexture");
+	GLuint u_lightDistanceTexture_rc = glGetUniformLocation(rcShader.ID, "u_lightDistanceTexture");
+	GLuint u_lightCount_rc = glGetUniformLocation(rcShader.ID, "u_lightCount");
+	GLuint u_feedbackTexture_rc = glGetUniformLocation(rcShader.ID, "u_feedbackTexture");
+	GLuint u_bounceAlbedo_rc = glGetUniformLocation(rcShader.ID, "u_bounceAlbedo");
+
+	GLuint u_resolution_light = glGetUniformLocation(lightShader.ID, "u_resolution");
+	GLuint u_lightReach_light = glGetUniformLocation(lightShader.ID, "u_lightReach");
+	GLuint u_countCulledProbes_rc = glGetUniformLocation(rcShader.ID, "u_countCulledProbes");
+
+	GLuint u_canvasTexture_occupancy = glGetUniformLocation(occupancyShader.ID, "u_canvasTexture");
+	GLuint u_resolution_occupancy = glGetUniformLocation(occupancyShader.ID, "u_resolution");
 	GLuint u_lastTexture_rc = glGetUniformLocation(rcShader.ID, "u_lastTexture");
 
 	GLuint u_finalRender_render = glGetUniformLocation(renderShader.ID, "u_finalRender");
 
-	const int jfa_passes = std::ceil(std::log2(std::max(WINDOW_WIDTH, WINDOW_HEIGHT))); // for jfa
+	const int jfa_passes = std::ceil(std::log2(std::max(canvasWidth, canvasHeight))); // for jfa
+
+	glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+	glBlendColor(0.0f, 0.0f, 0.0f, temporalBlend);
+
+	unsigned int frameIndex = 0;
+
+	SnapshotSaver snapshotSaver;
+
+	std::unique_ptr<FrameReadback> readback;
+	if (options.onFrame) {
+		readback.reset(new FrameReadback(canvasWidth, canvasHeight, options.onFrame));
+	}
+
+	std::unique_ptr<GpuTimer> timer;
+	if (options.timings) {
+		timer.reset(new GpuTimer(PASS_COUNT));
+		*options.timings = SessionTimings();
+	}
 
 	// BEGIN of main render loop
-	while (!glfwWindowShouldClose(window)) {
-		updateFPS();
+	while (!glfwWindowShouldClose(window) && (maxFrames < 0 || frameIndex < maxFrames)) {
+		updateFPS(cascadeCount + 1 - activeCascades);
+		const auto frameStart = std::chrono::steady_clock::now();
+
+		// Input is applied per frame, so a replay reproduces the recorded frames exactly
+		if (replay) replay->apply(frameIndex, mouseX, mouseY, mouseClicked, cursorSamples);
+		if (recorder) {
+			for (size_t i = 0; i + 1 < cursorSamples.size(); i += 2) {
+				recorder->record(frameIndex, cursorSamples[i], cursorSamples[i + 1], mouseClicked);
+			}
+			recorder->record(frameIndex, mouseX, mouseY, mouseClicked);
+		}
 
-		// PASS 1: Render brush strokes to canvas texture
-		glBindTexture(GL_TEXTURE_2D, canvasTexture);
-		glBindFramebuffer(GL_FRAMEBUFFER, canvasFBO);
+		// A scene image replaces the canvas once decoded; headless runs wait for it so they are reproducible
+		const bool sceneUploaded = sceneLoader && sceneLoader->upload(canvasTexture, options.headless);
+
+		// A restored snapshot replaces the canvas, and the distance field too when it has a matching one
+		bool snapshotRestored = false, distanceRestored = false;
+		if (snapshotLoadPending) {
+			snapshotLoadPending = false;
+
+			Snapshot snapshot;
+			if (loadSnapshot(snapshotFile.c_str(), snapshot)) {
+				if (snapshot.width != canvasWidth || snapshot.height != canvasHeight) {
+					std::cout << "Error: Snapshot is " << snapshot.width << "x" << snapshot.height << ", the canvas " << canvasWidth << "x" << canvasHeight << std::endl;
+				}
+				else {
+					glActiveTexture(GL_TEXTURE0);
+					glBindTexture(GL_TEXTURE_2D, canvasTexture);
+					glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, canvasWidth, canvasHeight, GL_RGBA, GL_FLOAT, snapshot.canvas.data());
+					snapshotRestored = true;
+
+					emissionStrokes.clearStrokes();
+					emissionStrokes.capsules = snapshot.emission;
+					emissionStrokes.strokeStarts.assign(snapshot.emissionStrokes.begin(), snapshot.emissionStrokes.end());
+
+					if (!snapshot.distance.empty() && distanceFieldTexture && snapshot.signedDistance == signedDistanceField) {
+						glActiveTexture(GL_TEXTURE3);
+						glBindTexture(GL_TEXTURE_2D, distanceFieldTexture);
+						glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, canvasWidth, canvasHeight, GL_RED, GL_FLOAT, snapshot.distance.data());
+						distanceRestored = true;
+					}
+					std::cout << "Restored snapshot " << snapshotFile << (distanceRestored ? " with its distance field" : "") << std::endl;
+				}
+			}
+		}
 
-		drawShader.activateShader();
+		// Painting adds a capsule between each pair of cursor samples since the last frame, ending
+		// at the current mouse position; a new press starts a new stroke with a dot. Lights and
+		// emission take their color from the segment's end, walls are black
+		const size_t emissionCapsules = emissionStrokes.capsules.size();
+		if (mouseClicked != 0) {
+			const bool strokeStart = mouseClicked != lastMouseClicked;
+			StrokeBuffer& layer = (mouseClicked == 3) ? emissionStrokes : strokes;
+			if (strokeStart) {
+				layer.beginStroke();
+				undoEmissionLayer.push_back(mouseClicked == 3);
+			}
 
-		glUniform2i(u_resolution_draw, WINDOW_WIDTH, WINDOW_HEIGHT);
-		glUniform2f(u_mousePos_draw, mouseX, mouseY);
-		glUniform2f(u_lastMousePos_draw, lastMouseX, lastMouseY);
-		glUniform1i(u_mouseClick_draw, mouseClicked);
-		glUniform1i(u_canvasTexture_draw, 0);
+			cursorSamples.push_back(mouseX);
+			cursorSamples.push_back(mouseY);
 
-		VAO.bindVAO();
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-		VAO.unbindVAO();
+			float fromX = lastMouseX, fromY = lastMouseY;
+			for (size_t i = 0; i + 1 < cursorSamples.size(); i += 2) {
+				const float toX = cursorSamples[i], toY = cursorSamples[i + 1];
+				if (toX == fromX && toY == fromY && !(strokeStart && i == 0)) continue;
 
-		// PASS 2: Render UV map to serve as seed input for the Jump Flood Algorithm
-		glBindTexture(GL_TEXTURE_2D, uvMapTexture);
-		glBindFramebuffer(GL_FRAMEBUFFER, uvMapFBO);
-		glClear(GL_COLOR_BUFFER_BIT);
+				const float light[4] = { (toX + 1.0f) / 2.0f, (toY + 1.0f) / 2.0f, 1.0f, 1.0f };
+				const float wall[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+				layer.addCapsule((fromX + 1.0f) / 2.0f, (fromY + 1.0f) / 2.0f, (toX + 1.0f) / 2.0f, (toY + 1.0f) / 2.0f,
+					brushRadius, (mouseClicked == 2) ? wall : light);
+				fromX = toX;
+				fromY = toY;
+			}
+		}
+		cursorSamples.clear();
+		lastMouseClicked = mouseClicked;
+		const bool strokesAdded = rasterizedCapsules < strokes.capsules.size();
+
+		const bool emissionAdded = emissionCapsules < emissionStrokes.capsules.size();
+
+		// Extent of this frame's change to the radiance in texels, the cascades refresh every level
+		// whose rays start within it. A fast stroke is queued as many short capsules, so the ones
+		// added this frame count together through their bounding box
+		float addedMinX = float(canvasWidth), addedMinY = float(canvasHeight), addedMaxX = 0.0f, addedMaxY = 0.0f;
+		auto includeAdded = [&](const Capsule& capsule) {
+			const float margin = capsule.params[0] * std::max(canvasWidth, canvasHeight);
+			addedMinX = std::min(addedMinX, std::min(capsule.segment[0], capsule.segment[2]) * canvasWidth - margin);
+			addedMinY = std::min(addedMinY, std::min(capsule.segment[1], capsule.segment[3]) * canvasHeight - margin);
+			addedMaxX = std::max(addedMaxX, std::max(capsule.segment[0], capsule.segment[2]) * canvasWidth + margin);
+			addedMaxY = std::max(addedMaxY, std::max(capsule.segment[1], capsule.segment[3]) * canvasHeight + margin);
+		};
+		for (size_t i = rasterizedCapsules; i < strokes.capsules.size(); i++) includeAdded(strokes.capsules[i]);
+		for (size_t i = emissionCapsules; i < emissionStrokes.capsules.size(); i++) includeAdded(emissionStrokes.capsules[i]);
+		float changeSize = 0.0f;
+		if (addedMinX <= addedMaxX && addedMinY <= addedMaxY) {
+			changeSize = std::sqrt((addedMaxX - addedMinX) * (addedMaxX - addedMinX) + (addedMaxY - addedMinY) * (addedMaxY - addedMinY));
+		}
 
-		uvShader.activateShader();
+		bool strokeUndone = false, emissionUndone = false;
+		if (undoPending && !undoEmissionLayer.empty()) {
+			if (undoEmissionLayer.back()) emissionUndone = emissionStrokes.undoStroke();
+			else strokeUndone = strokes.undoStroke();
+			undoEmissionLayer.pop_back();
+		}
+		undoPending = false;
 
-		glUniform2i(u_resolution_uv, WINDOW_WIDTH, WINDOW_HEIGHT);
-		glUniform1i(u_canvasTexture_uv, 0);
+		// A new base keeps the strokes painted on top of it, except a snapshot, which has them baked in
+		// and brings its own emission layer, whose strokes stay undoable
+		if (snapshotRestored) {
+			strokes.clearStrokes();
+			undoEmissionLayer.assign(emissionStrokes.strokeStarts.size(), true);
+		}
+		if (sceneUploaded || snapshotRestored) {
+			glCopyImageSubData(canvasTexture, GL_TEXTURE_2D, 0, 0, 0, 0, canvasBaseTexture, GL_TEXTURE_2D, 0, 0, 0, 0, canvasWidth, canvasHeight, 1);
+			rasterizedCapsules = 0;
+		}
+		if (strokeUndone) {
+			glCopyImageSubData(canvasBaseTexture, GL_TEXTURE_2D, 0, 0, 0, 0, canvasTexture, GL_TEXTURE_2D, 0, 0, 0, 0, canvasWidth, canvasHeight, 1);
+			rasterizedCapsules = 0;
+		}
 
-		VAO.bindVAO();
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-		VAO.unbindVAO();
+		// The canvas only changes while painting, when its content is replaced and on the first frame
+		const bool canvasDirty = strokesAdded || (frameIndex == 0) || sceneUploaded || snapshotRestored || strokeUndone;
+		// Undoing or replacing content changes the whole canvas, whatever was painted in the same frame
+		if (strokeUndone || emissionUndone || sceneUploaded || snapshotRestored || frameIndex == 0) changeSize = diagonalLength;
+		if (canvasDirty && !distanceRestored) distanceFieldDirty = true;
+
+		// PASS 1: Render the brush strokes not yet rasterized to canvas texture, touching only
+		// their bounding boxes
+		if (timer) timer->beginPass(PASS_BRUSH);
+		if (rasterizedCapsules < strokes.capsules.size()) {
+			glBindFramebuffer(GL_FRAMEBUFFER, canvasFBO);
+
+			strokes.upload();
+			strokes.bindStrokeBuffer(0);
+			strokeShader.activateShader();
+			glUniform1i(u_firstCapsule_stroke, GLint(rasterizedCapsules));
+
+			// Instances draw in order, so later capsules cover earlier ones like repainting did. The
+			// quad corners come from gl_VertexID, the VAO's attributes go unused
+			VAO.bindVAO();
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(strokes.capsules.size() - rasterizedCapsules));
+			VAO.unbindVAO();
+			rasterizedCapsules = strokes.capsules.size();
+		}
+		if (timer) timer->endPass();
 
-		// PASS 3: Run the Jump Flood Algorithm to generate a distance UV map
-		glBindTexture(GL_TEXTURE_2D, jfaTexture);
-		glBindFramebuffer(GL_FRAMEBUFFER, jfaFBO_A);
+		// Refresh the occupancy mask wherever the canvas may have changed
+		if (OCCUPANCY_MASK && (canvasDirty || options.rebuildDistanceField)) {
+			if (timer) timer->beginPass(PASS_OCCUPANCY);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, canvasTexture);
 
-		glClear(GL_COLOR_BUFFER_BIT);
+			occupancyShader.activateShader();
+			glUniform1i(u_canvasTexture_occupancy, 0);
+			glUniform2i(u_resolution_occupancy, canvasWidth, canvasHeight);
+			glDispatchCompute(occupancyTilesX, occupancyTilesY, 1);
 
-		jfaShader.activateShader();
-		glUniform2i(u_resolution_jfa, WINDOW_WIDTH, WINDOW_HEIGHT);
+			// rc.frag reads the mask through a storage block, the extent copies it
+			glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+			if (timer) timer->endPass();
 
-		GLuint currentInput = 1; // uvMapTexture
-		GLuint currentJfaFBO = jfaFBO_A;
-		GLuint lastJfaFBO = jfaFBO_B;
+			occupiedExtent->request(occupancyBuffer);
+		}
+		if (occupiedExtent) occupiedExtent->poll();
 
-		for (int i = 0; i < jfa_passes; i++) {
-			glUniform1i(u_inputTexture_jfa, currentInput);
-			glUniform1i(u_offset_jfa, std::pow(2, jfa_passes - i - 1));
+		// PASS 2: Render UV map to serve as seed input for the Jump Flood Algorithm (skipped when fused into PASS 3)
+		if (!FUSED_JFA_SEED) {
+			if (timer) timer->beginPass(PASS_UV);
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, uvMapTexture);
+			glBindFramebuffer(GL_FRAMEBUFFER, uvMapFBO);
+			glClear(GL_COLOR_BUFFER_BIT);
 
-			glBindTexture(GL_TEXTURE_2D, jfaTexture);
-			glBindFramebuffer(GL_FRAMEBUFFER, currentJfaFBO);
+			uvShader.activateShader();
+
+			glUniform2i(u_resolution_uv, canvasWidth, canvasHeight);
+			glUniform1i(u_canvasTexture_uv, 0);
 
 			VAO.bindVAO();
 			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 			VAO.unbindVAO();
+			if (timer) timer->endPass();
+		}
+
+		// PASS 3 and 4 only run when the canvas or the distance field settings changed
+		if (distanceFieldDirty || options.rebuildDistanceField) {
+			// PASS 3: Run the Jump Flood Algorithm to generate a distance UV map
+			if (timer) timer->beginPass(PASS_JFA);
+			jfaShader.activateShader();
+			glUniform1i(u_inputTexture_jfa, 2);
+			glUniform1i(u_canvasTexture_jfa, 0);
+			glUniform1i(u_exteriorSeedTexture_jfa, 6);
+
+			const std::vector<JfaPass> schedule = jfaSchedule(jfaMode, jfa_passes);
+
+			// Floods the seeds into jfaTextures[textureBase..textureBase + 3] and returns the final
+			// nearest-seed map; the last step also writes the distance field when writeDistance is set
+			auto runJumpFlood = [&](int textureBase, bool invertSeeds, bool writeDistance) {
+				GLuint jfaOutput = uvMapTexture;
+				int pingPong = 0;
+
+				glUniform1i(u_invertSeeds_jfa, invertSeeds);
+
+				for (size_t i = 0; i < schedule.size(); i++) {
+					const JfaPass& pass = schedule[i];
+					const int jfaWidth = pass.halfRes ? canvasWidth / 2 : canvasWidth;
+					const int jfaHeight = pass.halfRes ? canvasHeight / 2 : canvasHeight;
+					const int target = textureBase + (pass.halfRes ? 2 : 0) + pingPong;
+					const bool lastPass = i == schedule.size() - 1;
+
+					// The inverted flood always seeds from the canvas, the uv map only holds exterior seeds
+					glUniform2i(u_resolution_jfa, jfaWidth, jfaHeight);
+					glUniform1i(u_seedFromCanvas_jfa, (FUSED_JFA_SEED || invertSeeds) && i == 0);
+					glUniform1i(u_refineWithCanvas_jfa, i > 0 && schedule[i - 1].halfRes && !pass.halfRes);
+					glUniform1i(u_signedDistance_jfa, invertSeeds && lastPass);
+					glUniform1i(u_offset_jfa, pass.offset);
+
+					glActiveTexture(GL_TEXTURE2);
+					glBindTexture(GL_TEXTURE_2D, jfaOutput);
+
+					if (writeDistance && lastPass) {
+						glBindFramebuffer(GL_FRAMEBUFFER, jfaFinalFBO);
+						glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, jfaTextures[target], 0);
+					}
+					else {
+						glBindFramebuffer(GL_FRAMEBUFFER, jfaFramebuffers[target]);
+					}
+					glViewport(0, 0, jfaWidth, jfaHeight);
+
+					VAO.bindVAO();
+					glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+					VAO.unbindVAO();
+
+					jfaOutput = jfaTextures[target];
+					pingPong = 1 - pingPong;
+				}
+				glViewport(0, 0, canvasWidth, canvasHeight);
+
+				return jfaOutput;
+			};
+
+			// With a signed field the last step of the interior flood writes exterior minus interior distance
+			const bool fusedDistance = FUSED_JFA_DIST && !DISTANCE_FROM_SEED;
+			const GLuint exteriorSeeds = runJumpFlood(0, false, fusedDistance && !signedDistanceField);
+
+			glActiveTexture(GL_TEXTURE6);
+			glBindTexture(GL_TEXTURE_2D, exteriorSeeds);
+
+			if (signedDistanceField) {
+				const GLuint interiorSeeds = runJumpFlood(4, true, fusedDistance);
+
+				glActiveTexture(GL_TEXTURE7);
+				glBindTexture(GL_TEXTURE_2D, interiorSeeds);
+			}
+
+			// Later passes read the exterior nearest-seed map from unit 2 and the interior one from unit 7
+			glActiveTexture(GL_TEXTURE2);
+			glBindTexture(GL_TEXTURE_2D, exteriorSeeds);
+			if (timer) timer->endPass();
+
+			if (jfaReportPending) {
+				reportJfa(schedule, canvasTexture, exteriorSeeds, canvasWidth, canvasHeight);
+				jfaReportPending = false;
+			}
+
+			// PASS 4: Create distance field from the output of the Jump Flood Algorithm (skipped when fused into PASS 3)
+			if (!FUSED_JFA_DIST && !DISTANCE_FROM_SEED) {
+				if (timer) timer->beginPass(PASS_DISTANCE);
+				glActiveTexture(GL_TEXTURE3);
+				glBindTexture(GL_TEXTURE_2D, distanceFieldTexture);
+				glBindFramebuffer(GL_FRAMEBUFFER, distanceFieldFBO);
+				glClear(GL_COLOR_BUFFER_BIT);
+
+				distShader.activateShader();
+
+				glUniform1i(u_jfaTexture_dist, 2);
+				glUniform1i(u_jfaInteriorTexture_dist, 7);
+				glUniform1i(u_signedField_dist, signedDistanceField);
 
-			currentInput = 2; // jfaTexture
-			std::swap(currentJfaFBO, lastJfaFBO);
+				VAO.bindVAO();
+				glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+				VAO.unbindVAO();
+				if (timer) timer->endPass();
+			}
+
+			if (timer) timer->beginPass(PASS_PYRAMID);
+			buildDistancePyramid();
+			if (timer) timer->endPass();
+			distanceFieldDirty = false;
+		}
+		else if (distanceRestored) {
+			// Snapshots only store level 0
+			buildDistancePyramid();
 		}
 
-		// PASS 4: Create distance field from the output of the Jump Flood Algorithm
-		glBindTexture(GL_TEXTURE_2D, distanceFieldTexture);
-		glBindFramebuffer(GL_FRAMEBUFFER, distanceFieldFBO);
-		glClear(GL_COLOR_BUFFER_BIT);
+		// Emitters are splatted again when the emission layer changes and on every frame the
+		// analytic lights are on, as they move; the cascades treat that like a canvas change
+		const bool emissionDirty = emissionAdded || emissionUndone || snapshotRestored || orbitingLights > 0 || lightsShown;
+		if ((orbitingLights > 0) != lightsShown) changeSize = diagonalLength;
+		lightsShown = orbitingLights > 0;
+		const size_t lightCount = (orbitingLights > 0) ? size_t(orbitingLights) : 0;
+		const size_t emitterCount = lightCount + emissionStrokes.capsules.size();
+		if (emissionDirty && emitterCount > 0) {
+			if (timer) timer->beginPass(PASS_LIGHTS);
+			if (lightCount > 0) {
+				placeOrbitingLights(lights, orbitingLights, frameIndex / 60.0f);
+				lights.upload();
+				for (const Light& light : lights.lights) {
+					changeSize = std::max(changeSize, lightSize(light.segment, light.params[0]));
+				}
+			}
+			emissionStrokes.upload();
 
-		distShader.activateShader();
+			// Far from every light the distance texture keeps the reach, still a lower bound
+			const GLfloat noEmission[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			const GLfloat lightReach[] = { LIGHT_REACH, 0.0f, 0.0f, 0.0f };
+			glBindFramebuffer(GL_FRAMEBUFFER, lightFBO);
+			glClearBufferfv(GL_COLOR, 0, noEmission);
+			glClearBufferfv(GL_COLOR, 1, lightReach);
 
-		glUniform1i(u_jfaTexture_dist, 2);
+			glEnable(GL_BLEND);
+			glBlendFunci(0, GL_ONE, GL_ONE);
+			glBlendEquationi(1, GL_MIN);
 
-		VAO.bindVAO();
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-		VAO.unbindVAO();
+			lightShader.activateShader();
+			glUniform2i(u_resolution_light, canvasWidth, canvasHeight);
+			glUniform1f(u_lightReach_light, LIGHT_REACH);
 
-		// PASS 5: Radiance Cascade implementation
-		const int baseRayCount = 16;
-		const float diagonalLength = sqrt(WINDOW_WIDTH * WINDOW_WIDTH + WINDOW_HEIGHT * WINDOW_HEIGHT);
-		const int cascadeCount = int(ceil(log(diagonalLength) / log(baseRayCount))) + 1;
+			// Emission strokes share the light layout (their color alpha is the intensity). Lights
+			// add up, but the capsules of a stroke overlap at every joint, so strokes keep the brightest
+			VAO.bindVAO();
+			if (lightCount > 0) {
+				lights.bindLightBuffer(3);
+				glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(lightCount));
+			}
+			if (!emissionStrokes.capsules.empty()) {
+				glBlendEquationi(0, GL_MAX);
+				emissionStrokes.bindStrokeBuffer(3);
+				glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(emissionStrokes.capsules.size()));
+			}
+			VAO.unbindVAO();
+
+			// Back to the blending the temporal cascades use
+			glDisable(GL_BLEND);
+			glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+			glBlendEquation(GL_FUNC_ADD);
+			if (timer) timer->endPass();
+		}
+
+		// Turning the feedback on starts from no reflected light. Each frame adds a bounce, a
+		// change spread thinly over the whole canvas that the upper levels can catch up with
+		if (bounceFeedback && !bounceShown) {
+			const GLfloat noRadiance[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (int i = 0; i < 2; i++) {
+				glBindFramebuffer(GL_FRAMEBUFFER, feedbackFBOs[i]);
+				glClearBufferfv(GL_COLOR, 0, noRadiance);
+			}
+		}
+		const bool bounceDirty = bounceFeedback || bounceShown;
+		bounceShown = bounceFeedback;
+		// The cascades cover the paint's extent, the whole canvas until the latest mask has been
+		// reduced, grown by every light and emission stroke: those only live in the light textures
+		int extentMinX = 0, extentMinY = 0, extentMaxX = canvasWidth, extentMaxY = canvasHeight;
+		if (occupiedExtent && occupiedExtent->valid) {
+			extentMinX = occupiedExtent->empty() ? canvasWidth : occupiedExtent->minX;
+			extentMinY = occupiedExtent->empty() ? canvasHeight : occupiedExtent->minY;
+			extentMaxX = occupiedExtent->empty() ? 0 : occupiedExtent->maxX;
+			extentMaxY = occupiedExtent->empty() ? 0 : occupiedExtent->maxY;
+		}
+		auto includeEmitter = [&](const float segment[4], float radius) {
+			const float margin = radius + LIGHT_REACH;
+			extentMinX = std::min(extentMinX, std::max(int(std::floor((std::min(segment[0], segment[2]) - margin) * canvasWidth)), 0));
+			extentMinY = std::min(extentMinY, std::max(int(std::floor((std::min(segment[1], segment[3]) - margin) * canvasHeight)), 0));
+			extentMaxX = std::max(extentMaxX, std::min(int(std::ceil((std::max(segment[0], segment[2]) + margin) * canvasWidth)), canvasWidth));
+			extentMaxY = std::max(extentMaxY, std::min(int(std::ceil((std::max(segment[1], segment[3]) + margin) * canvasHeight)), canvasHeight));
+		};
+		if (lightCount > 0) {
+			for (const Light& light : lights.lights) includeEmitter(light.segment, light.params[0]);
+		}
+		for (const Capsule& capsule : emissionStrokes.capsules) includeEmitter(capsule.segment, capsule.params[0]);
+		activeCascades = reachableCascades(extentMinX, extentMinY, extentMaxX, extentMaxY);
+
+		const bool radianceChanged = canvasDirty || emissionDirty || bounceDirty || activeCascades != lastActiveCascades;
+		if (activeCascades != lastActiveCascades) changeSize = diagonalLength;
+		lastActiveCascades = activeCascades;
 
-		GLuint currTexture	= rcTexture_A;
-		GLuint lastTexture	= rcTexture_B;
-		GLuint currFBO = rcFBO_A;
-		GLuint lastFBO = rcFBO_B;
+		// Only frames after the warmup count towards the timings
+		const bool measured = options.timings && frameIndex >= options.warmupFrames;
 
+		// PASS 5: Radiance Cascade implementation
+		if (timer) timer->beginPass(PASS_CASCADES);
 		rcShader.activateShader();
 
-		glUniform2i(u_resolution_rc, WINDOW_WIDTH, WINDOW_HEIGHT);
+		glUniform2i(u_resolution_rc, canvasWidth, canvasHeight);
 		glUniform2f(u_mousePos_rc, mouseX, mouseY);
 		glUniform1i(u_mouseClick_rc, mouseClicked);
 		glUniform1i(u_baseRayCount_rc, baseRayCount);
-		glUniform1i(u_cascadeCount_rc, cascadeCount);
+		glUniform1i(u_cascadeCount_rc, activeCascades);
 		glUniform1i(u_canvasTexture_rc, 0);
 		glUniform1i(u_distanceFieldTexture_rc, 3);
+		glUniform1i(u_jfaTexture_rc, 2);
+		glUniform1i(u_distanceFromSeed_rc, DISTANCE_FROM_SEED);
+		glUniform1i(u_jfaInteriorTexture_rc, 7);
+		glUniform1i(u_signedField_rc, signedDistanceField);
+		glUniform1i(u_distanceMipLevels_rc, distanceMipLevels);
+		glUniform1i(u_occupancyTileSize_rc, OCCUPANCY_MASK ? OCCUPANCY_TILE_SIZE : 0);
+		glUniform1i(u_lastTexture_rc, 4);
+		glUniform1i(u_cullProbes_rc, CULL_BURIED_PROBES);
+		glUniform1i(u_lightTexture_rc, 8);
+		glUniform1i(u_lightDistanceTexture_rc, 9);
+		glUniform1i(u_lightCount_rc, GLint(emitterCount));
+		glUniform1i(u_feedbackTexture_rc, 10);
+		glUniform1f(u_bounceAlbedo_rc, bounceFeedback ? BOUNCE_ALBEDO : 0.0f);
+		glActiveTexture(GL_TEXTURE10);
+		glBindTexture(GL_TEXTURE_2D, feedbackTextures[feedbackIndex]);
+
+		// Culled probes are only counted on measured frames, the counter costs an atomic per probe
+		glUniform1i(u_countCulledProbes_rc, measured);
+		if (measured) {
+			glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, culledProbeCounter);
+			glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &zeroCount);
+			glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+		}
+		int cascadePasses = 0;
 
-		int prev = 0;
-		for (int i = cascadeCount; i >= 0; i--) {
+		for (int i = activeCascades - 1; i >= 0; i--) {
 			glUniform1i(u_cascadeIndex_rc, i);
+			glUniform1i(u_rayDirectionOffset_rc, rayDirectionOffsets[i]);
 
-			if (i > 0) {
-				glBindFramebuffer(GL_FRAMEBUFFER, rcFramebuffers[prev]);
-				glClear(GL_COLOR_BUFFER_BIT);
+			glActiveTexture(GL_TEXTURE4);
+			glBindTexture(GL_TEXTURE_2D, (i < activeCascades - 1) ? rcTextures[i + 1] : 0);
 
-				glActiveTexture(GL_TEXTURE4);
-				glBindTexture(GL_TEXTURE_2D, rcTextures[1- prev]);
-				glUniform1i(u_lastTexture_rc, 4);
+			if (i > 0) {
+				// A change at least as large as where the level's rays start (5 * baseRayCount^(i-1)
+				// texels out) refreshes it right away. Smaller ones only reach it from probes around
+				// them as a sliver of their view, so the level catches up on frames where
+				// frameIndex % 2^i == 2^(i-1), which upper levels never share
+				const bool changeReaches = radianceChanged && 5.0 * pow(baseRayCount, i - 1) <= changeSize;
+				const bool staggeredRefresh = (frameIndex % (1u << i)) == (1u << (i - 1));
+				bool blendHistory = false;
+				if (temporalCascades && !changeReaches) {
+					if (radianceChanged) cascadeStale[i] = true;
+					if (!cascadeStale[i] || !staggeredRefresh) continue;
+
+					// While the radiance keeps changing, catching up blends with the history to
+					// hide the lag; once it settled the refresh is exact
+					blendHistory = radianceChanged;
+				}
+				cascadeStale[i] = blendHistory;
+				for (int lower = 1; lower < i; lower++) cascadeStale[lower] = true;
+				cascadePasses++;
+
+				glBindFramebuffer(GL_FRAMEBUFFER, rcFramebuffers[i]);
+
+				if (blendHistory) glEnable(GL_BLEND);
+				else glClear(GL_COLOR_BUFFER_BIT);
 
 				VAO.bindVAO();
 				glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 				VAO.unbindVAO();
 
-				prev = 1 - prev;
+				glDisable(GL_BLEND);
 			}
 
 			else {
-				glBindFramebuffer(GL_FRAMEBUFFER, 0);  
+				// The feedback keeps level 0 for the next frame and shows it with render.frag
+				const GLuint levelZeroFBO = bounceFeedback ? feedbackFBOs[1 - feedbackIndex] : 0;
+				glBindFramebuffer(GL_FRAMEBUFFER, levelZeroFBO);
 				glClear(GL_COLOR_BUFFER_BIT);
+				cascadePasses++;
 
-				glActiveTexture(GL_TEXTURE4);
-				glBindTexture(GL_TEXTURE_2D, rcTextures[1-prev]);
-				glUniform1i(u_lastTexture_rc, 4);
-
+				// Linear radiance is encoded on write; the canvas and upper cascades never are
+				if (SRGB_CANVAS && !bounceFeedback) glEnable(GL_FRAMEBUFFER_SRGB);
 				VAO.bindVAO();
 				glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 				VAO.unbindVAO();
+				if (SRGB_CANVAS && !bounceFeedback) glDisable(GL_FRAMEBUFFER_SRGB);
 			}
 		}
 
+		if (bounceFeedback) {
+			feedbackIndex = 1 - feedbackIndex;
+
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glClear(GL_COLOR_BUFFER_BIT);
+			renderShader.activateShader();
+			glUniform1i(u_finalRender_render, 10);
+			glActiveTexture(GL_TEXTURE10);
+			glBindTexture(GL_TEXTURE_2D, feedbackTextures[feedbackIndex]);
+
+			if (SRGB_CANVAS) glEnable(GL_FRAMEBUFFER_SRGB);
+			VAO.bindVAO();
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+			VAO.unbindVAO();
+			if (SRGB_CANVAS) glDisable(GL_FRAMEBUFFER_SRGB);
+		}
+		if (timer) timer->endPass();
+		if (timer) timer->endFrame(measured);
+
+		// Queue the copy of this frame and hand out the ones that finished copying meanwhile
+		// Snapshots are saved from the state after this frame's Jump Flood
+		if (snapshotSavePending) {
+			snapshotSavePending = false;
+			const GLuint savedDistance = (SNAPSHOT_DISTANCE_FIELD && !DISTANCE_FROM_SEED) ? distanceFieldTexture : 0;
+			snapshotSaver.requestSave(snapshotFile, canvasTexture, savedDistance, signedDistanceField, canvasWidth, canvasHeight, emissionStrokes);
+		}
+		snapshotSaver.poll();
+
+		if (readback) {
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			readback->capture(frameIndex);
+			readback->poll();
+		}
+
 		lastMouseX = mouseX;
 		lastMouseY = mouseY;
+		frameIndex++;
 
 		glfwSwapBuffers(window);
+
+		if (measured) {
+			glFinish();
+			const double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+			SessionTimings& timings = *options.timings;
+			timings.minFrameMs = (timings.frames == 0) ? frameMs : std::min(timings.minFrameMs, frameMs);
+			timings.maxFrameMs = std::max(timings.maxFrameMs, frameMs);
+			timings.frameMs += frameMs;
+			timings.elidedCascades += cascadeCount + 1 - activeCascades;
+
+			// Every texel of a cascade pass is a probe casting baseRayCount rays
+			GLuint culledProbes = 0;
+			glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, culledProbeCounter);
+			glGetBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &culledProbes);
+			glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+			timings.culledRays += double(culledProbes) * baseRayCount;
+			timings.cascadeRays += double(cascadePasses) * canvasWidth * canvasHeight * baseRayCount;
+			timings.frames++;
+		}
+
 		glfwPollEvents();
 	}
 
+	if (timer) {
+		timer->flush();
+		options.timings->passMs = timer->passMs;
+		timer->deleteTimer();
+	}
+
 	// Clean up
+	if (readback) readback->deleteReadback();
+	if (sceneLoader) sceneLoader->deleteLoader();
+	snapshotSaver.deleteSaver();
+	if (recorder) recorder->closeRecorder();
 	VAO.deleteVAO();
 	VBO.deleteVBO();
 	EBO.deleteEBO();
-	drawShader.deleteShader();
+	strokeShader.deleteShader();
+	strokes.deleteStrokeBuffer();
+	mipShader.deleteShader();
+	if (distanceMipFBO) glDeleteFramebuffers(1, &distanceMipFBO);
+	occupancyShader.deleteShader();
+	if (occupancyBuffer) glDeleteBuffers(1, &occupancyBuffer);
+	if (occupiedExtent) occupiedExtent->deleteExtent();
+	glDeleteFramebuffers(cascadeCount - 1, rcFramebuffers.data() + 1);
+	glDeleteTextures(cascadeCount - 1, rcTextures.data() + 1);
+	glDeleteBuffers(1, &rayDirectionBuffer);
+	glDeleteBuffers(1, &culledProbeCounter);
+	lightShader.deleteShader();
+	lights.deleteLightBuffer();
+	emissionStrokes.deleteStrokeBuffer();
+	glDeleteFramebuffers(1, &lightFBO);
+	glDeleteTextures(2, lightTextures);
+	glDeleteFramebuffers(2, feedbackFBOs);
+	glDeleteTextures(2, feedbackTextures);
+	glDeleteTextures(1, &canvasBaseTexture);
 	renderShader.deleteShader();
 	glfwDestroyWindow(window);
 	glfwTerminate();
 
 	return 0;
-}
\ No newline at end of file
+}
+
+// Configurations every benchmark scene is rendered with
+struct BenchmarkConfig {
+	const char* name;
+	bool temporalCascades;
+	JfaMode jfaMode;
+	bool signedDistanceField;
+};
+
+const BenchmarkConfig BENCHMARK_CONFIGS[] = {
+	{ "baseline",          false, JFA_STANDARD, false },
+	{ "temporal_cascades", true,  JFA_STANDARD, false },
+	{ "half_res_jfa",      false, JFA_HALF_RES, false },
+	{ "signed_field",      false, JFA_STANDARD, true  },
+};
+
+// Quotes text as a JSON string. Scene names can be image paths, with backslashes or quotes
+std::string jsonString(const char* text) {
+	static const char hexDigits[] = "0123456789abcdef";
+	std::string quoted = "\"";
+	for (const char* c = text; *c; c++) {
+		const unsigned char code = (unsigned char)*c;
+		if (code == '"' || code == '\\') {
+			quoted += '\\';
+			quoted += *c;
+		}
+		else if (code < 0x20) {
+			quoted += "\\u00";
+			quoted += hexDigits[code >> 4];
+			quoted += hexDigits[code & 15];
+		}
+		else quoted += *c;
+	}
+	return quoted + "\"";
+}
+
+// Renders every scene (or only sceneFilter) with every configuration in a hidden window and
+// writes the mean frame and per-pass GPU times as JSON, so runs can be compared across changes
+int runBenchmark(const char* outFile, const char* sceneFilter, long warmupFrames, long measuredFrames) {
+	// A filter naming an image file benchmarks that image instead of the canned scenes
+	std::vector<Scene> scenes(SCENES, SCENES + SCENE_COUNT);
+	if (sceneFilter && !findScene(sceneFilter)) {
+		Scene imageScene = { sceneFilter, 0, 0, NULL };
+		if (!SceneLoader::imageSize(sceneFilter, imageScene.width, imageScene.height)) {
+			std::cout << "Error: Unknown benchmark scene " << sceneFilter << std::endl;
+			return -1;
+		}
+		scenes.assign(1, imageScene);
+	}
+
+	std::ofstream out(outFile);
+	if (!out) {
+		std::cout << "Error: Could not open " << outFile << std::endl;
+		return -1;
+	}
+
+	out << std::boolalpha << "{\n";
+	out << "  \"build\": { \"fusedJfaSeed\": " << FUSED_JFA_SEED << ", \"fusedJfaDist\": " << FUSED_JFA_DIST
+		<< ", \"distanceFromSeed\": " << DISTANCE_FROM_SEED << ", \"distanceMipLevels\": " << DISTANCE_MIP_LEVELS
+		<< ", \"occupancyMask\": " << OCCUPANCY_MASK << ", \"srgbCanvas\": " << SRGB_CANVAS
+		<< ", \"cullBuriedProbes\": " << CULL_BURIED_PROBES << " },\n";
+	out << "  \"orbitingLights\": " << orbitingLights << ",\n";
+	out << "  \"bounceFeedback\": " << bounceFeedback << ",\n";
+	out << "  \"warmupFrames\": " << warmupFrames << ",\n";
+	out << "  \"measuredFrames\": " << measuredFrames << ",\n";
+	out << "  \"results\": [";
+
+	bool firstResult = true;
+	for (const Scene& scene : scenes) {
+		if (sceneFilter && strcmp(sceneFilter, scene.name) != 0) continue;
+
+		for (const BenchmarkConfig& config : BENCHMARK_CONFIGS) {
+			std::cout << "Benchmarking " << scene.name << " (" << scene.width << "x" << scene.height << ") with " << config.name << std::endl;
+
+			temporalCascades = config.temporalCascades;
+			jfaMode = config.jfaMode;
+			signedDistanceField = config.signedDistanceField;
+
+			SessionTimings timings;
+			SessionOptions options;
+			options.width = scene.width;
+			options.height = scene.height;
+			options.headless = true;
+			options.maxFrames = warmupFrames + measuredFrames;
+			options.warmupFrames = warmupFrames;
+			options.scene = scene.paint ? &scene : NULL;
+			options.sceneFile = scene.paint ? NULL : scene.name;
+			options.timings = &timings;
+			options.rebuildDistanceField = true;
+
+			if (runSession(options) != 0) return -1;
+			const double frames = (timings.frames > 0) ? (double)timings.frames : 1.0;
+
+			out << (firstResult ? "\n" : ",\n");
+			out << "    { \"scene\": " << jsonString(scene.name) << ", \"width\": " << scene.width << ", \"height\": " << scene.height
+				<< ", \"config\": " << jsonString(config.name) << ", \"frames\": " << timings.frames << ",\n";
+			out << "      \"frameMs\": { \"mean\": " << timings.frameMs / frames << ", \"min\": " << timings.minFrameMs
+				<< ", \"max\": " << timings.maxFrameMs << " },\n";
+			out << "      \"elidedCascadePasses\": " << timings.elidedCascades / frames << ", \"raysPerFrame\": " << timings.cascadeRays / frames
+				<< ", \"culledRaysPerFrame\": " << timings.culledRays / frames << ",\n";
+			out << "      \"passMs\": {";
+			for (int pass = 0; pass < PASS_COUNT; pass++) {
+				const double passMs = (pass < (int)timings.passMs.size()) ? timings.passMs[pass] / frames : 0.0;
+				out << (pass ? ", " : " ") << "\"" << RENDER_PASS_NAMES[pass] << "\": " << passMs;
+			}
+			out << " } }";
+			firstResult = false;
+		}
+	}
+	out << "\n  ]\n}\n";
+
+	std::cout << "Benchmark results written to " << outFile << std::endl;
+	return 0;
+}
+
+// Golden-image tolerances: the lighting may drift by a few levels from driver or precision
+// differences, anything structural shows up in the PSNR and SSIM
+const int GOLDEN_PIXEL_TOLERANCE = 8;
+const double GOLDEN_MAX_PIXELS_OVER = 0.001;	// fraction of the image
+const double GOLDEN_MIN_PSNR = 40.0;
+const double GOLDEN_MIN_SSIM = 0.98;
+const long GOLDEN_FRAMES = 2;
+
+// Renders every scene (or only sceneFilter) with the baseline configuration and compares the
+// final image against <directory>/<scene>.png. On a mismatch <scene>_actual.png and
+// <scene>_diff.png are written next to it. With update set the golden images are rewritten
+int runGoldenTests(const char* directory, const char* sceneFilter, bool update) {
+	if (sceneFilter && !findScene(sceneFilter)) {
+		std::cout << "Error: Unknown golden scene " << sceneFilter << std::endl;
+		return -1;
+	}
+
+	temporalCascades = false;
+	jfaMode = JFA_STANDARD;
+	signedDistanceField = false;
+	stbi_flip_vertically_on_write(1);
+
+	int failures = 0;
+	for (int s = 0; s < SCENE_COUNT; s++) {
+		const Scene& scene = SCENES[s];
+		if (sceneFilter && strcmp(sceneFilter, scene.name) != 0) continue;
+
+		std::vector<unsigned char> actual;
+		SessionOptions options;
+		options.width = scene.width;
+		options.height = scene.height;
+		options.headless = true;
+		options.maxFrames = GOLDEN_FRAMES;
+		options.scene = &scene;
+		options.onFrame = [&actual](unsigned int frame, const unsigned char* pixels, int width, int height) {
+			if (frame + 1 != GOLDEN_FRAMES) return;
+			actual.resize(width * height * 3);
+			for (int i = 0; i < width * height; i++) {
+				actual[i * 3] = pixels[i * 4];
+				actual[i * 3 + 1] = pixels[i * 4 + 1];
+				actual[i * 3 + 2] = pixels[i * 4 + 2];
+			}
+		};
+		if (runSession(options) != 0 || actual.empty()) return -1;
+
+		const std::string goldenFile = std::string(directory) + "/" + scene.name + ".png";
+		if (update) {
+			if (!stbi_write_png(goldenFile.c_str(), scene.width, scene.height, 3, actual.data(), scene.width * 3)) {
+				std::cout << "Error: Could not write " << goldenFile << std::endl;
+				return -1;
+			}
+			std::cout << "Updated " << goldenFile << std::endl;
+			continue;
+		}
+
+		int width, height, channels;
+		stbi_set_flip_vertically_on_load(true);
+		unsigned char* golden = stbi_load(goldenFile.c_str(), &width, &height, &channels, 3);
+		stbi_set_flip_vertically_on_load(false);
+		if (golden == NULL || width != scene.width || height != scene.height) {
+			std::cout << "FAIL " << scene.name << ": missing or mismatched golden image " << goldenFile << std::endl;
+			if (golden) stbi_image_free(golden);
+			failures++;
+			continue;
+		}
+		const std::vector<unsigned char> expected(golden, golden + width * height * 3);
+		stbi_image_free(golden);
+
+		std::vector<unsigned char> diff;
+		const ImageDifference result = compareImages(expected, actual, width, height, GOLDEN_PIXEL_TOLERANCE, &diff);
+		const bool passed = result.pixelsOverTolerance <= GOLDEN_MAX_PIXELS_OVER * width * height
+			&& result.psnr >= GOLDEN_MIN_PSNR && result.ssim >= GOLDEN_MIN_SSIM;
+
+		std::cout << (passed ? "PASS " : "FAIL ") << scene.name << ": max difference " << result.maxDifference
+			<< ", " << result.pixelsOverTolerance << " pixels over tolerance, PSNR " << result.psnr
+			<< " dB, SSIM " << result.ssim << std::endl;
+
+		if (!passed) {
+			const std::string prefix = std::string(directory) + "/" + scene.name;
+			stbi_write_png((prefix + "_actual.png").c_str(), width, height, 3, actual.data(), width * 3);
+			stbi_write_png((prefix + "_diff.png").c_str(), width, height, 3, diff.data(), width * 3);
+			failures++;
+		}
+	}
+
+	if (failures > 0) std::cout << failures << " golden image test(s) failed" << std::endl;
+	return (failures > 0) ? 1 : 0;
+}
+
+// Frame rate written into captured streams and frames buffered before the capture drops frames
+const int CAPTURE_FPS = 60;
+const size_t CAPTURE_QUEUE_FRAMES = 8;
+
+int main(int argc, char** argv) {
+
+	// Command line: --record <file> logs the mouse input of every frame, --replay <file> plays a
+	// recording back instead of the live mouse, --frames <n> stops after n frames, --headless
+	// hides the window. --benchmark <file.json> runs the scene corpus instead (--warmup <n>,
+	// --measure <n> and --scene <name|image> adjust it). --golden <dir> compares the scenes against the
+	// golden images in dir, --update-golden <dir> rewrites them. --capture <file.y4m|file.rgb|->
+	// streams the rendered frames to a video file or stdout. --snapshot <file> restores a saved
+	// canvas and is where F5 saves it. --lights <n> starts with n analytic lights circling the canvas,
+	// --bounce with the bounce feedback on
+	SessionOptions options;
+	const char* benchmarkFile = NULL;
+	const char* benchmarkScene = NULL;
+	const char* goldenDirectory = NULL;
+	bool updateGolden = false;
+	const char* captureFile = NULL;
+	long warmupFrames = 30, measuredFrames = 100;
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 < argc && strcmp(argv[i], "--record") == 0) options.recordFile = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "--replay") == 0) options.replayFile = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) options.maxFrames = atol(argv[++i]);
+		else if (strcmp(argv[i], "--headless") == 0) options.headless = true;
+		else if (i + 1 < argc && strcmp(argv[i], "--benchmark") == 0) benchmarkFile = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "--warmup") == 0) warmupFrames = atol(argv[++i]);
+		else if (i + 1 < argc && strcmp(argv[i], "--measure") == 0) measuredFrames = atol(argv[++i]);
+		else if (i + 1 < argc && strcmp(argv[i], "--scene") == 0) benchmarkScene = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "--snapshot") == 0) options.snapshotFile = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "--lights") == 0) orbitingLights = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bounce") == 0) bounceFeedback = true;
+		else if (i + 1 < argc && strcmp(argv[i], "--capture") == 0) captureFile = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "--golden") == 0) goldenDirectory = argv[++i];
+		else if (i + 1 < argc && strcmp(argv[i], "--update-golden") == 0) {
+			goldenDirectory = argv[++i];
+			updateGolden = true;
+		}
+		else std::cout << "Ignoring unknown option " << argv[i] << std::endl;
+	}
+
+	if (goldenDirectory) {
+		return runGoldenTests(goldenDirectory, benchmarkScene, updateGolden);
+	}
+	if (benchmarkFile) {
+		return runBenchmark(benchmarkFile, benchmarkScene, warmupFrames, measuredFrames);
+	}
+
+	// --scene <name|image> starts an interactive session from a canned scene or an image file
+	if (benchmarkScene) {
+		options.scene = findScene(benchmarkScene);
+		if (options.scene) {
+			options.width = options.scene->width;
+			options.height = options.scene->height;
+		}
+		else {
+			options.sceneFile = benchmarkScene;
+			SceneLoader::imageSize(benchmarkScene, options.width, options.height);
+		}
+	}
+
+	if (options.snapshotFile) {
+		snapshotSize(options.snapshotFile, options.width, options.height);
+	}
+
+	if (captureFile) {
+		// Keep the log out of a video piped through stdout
+		if (strcmp(captureFile, "-") == 0) std::cout.rdbuf(std::cerr.rdbuf());
+
+		FrameWriter writer(captureFile, options.width, options.height, CAPTURE_FPS, CAPTURE_QUEUE_FRAMES);
+		if (!writer.valid) return -1;
+
+		options.onFrame = [&writer](unsigned int, const unsigned char* pixels, int, int) {
+			writer.push(pixels);
+		};
+		const int result = runSession(options);
+		writer.closeWriter();
+		return result;
+	}
+	return runSession(options);
+}
@@ -0,0 +1,22 @@
+#version 430 core
+
+in vec2 uv;
+in vec4 color;
+
+out vec4 FragColor;
+
+// Source level, selected by restricting the texture's base and max level to it so the level
+// being rendered is never sampled
+uniform sampler2D u_distanceFieldTexture;
+
+void main() {
+    // Smallest distance of the 2x2 texels below, so a level L texel bounds the distance
+    // field over its 2^L x 2^L tile from below
+    ivec2 coord = ivec2(gl_FragCoord.xy) * 2;
+    float d00 = texelFetch(u_distanceFieldTexture, coord, 0).x;
+    float d10 = texelFetch(u_distanceFieldTexture, coord + ivec2(1, 0), 0).x;
+    float d01 = texelFetch(u_distanceFieldTexture, coord + ivec2(0, 1), 0).x;
+    float d11 = texelFetch(u_distanceFieldTexture, coord + ivec2(1, 1), 0).x;
+
+    FragColor = vec4(min(min(d00, d10), min(d01, d11)));
+}
@@ -21,10 +21,37 @@ uniform int     u_cascadeCount;
 uniform sampler2D u_canvasTexture;
 uniform sampler2D u_distanceFieldTexture;
 uniform sampler2D u_lastTexture;
+uniform sampler2D u_jfaTexture;
+uniform sampler2D u_jfaInteriorTexture;
+uniform int       u_distanceFromSeed; // derive distances from the JFA seeds instead of the distance field
+uniform int       u_signedField;      // distances are negative inside occluders
+uniform int       u_distanceMipLevels; // min-distance pyramid levels above the distance field, 0 for none
+uniform int       u_occupancyTileSize; // texels per occupancy tile side, 0 when there is no mask
+
+// Per cascade: the baseRayCount rotations within a probe's ray group, then the direction of each
+// group's first ray edge; a ray's direction is the complex product of the two
+layout(std430, binding = 2) readonly buffer RayDirections {
+    vec2 rayDirections[];
+};
+uniform int       u_rayDirectionOffset;  // where this cascade's table starts
+
+uniform sampler2D u_lightTexture;        // emission of the analytic lights
+uniform sampler2D u_lightDistanceTexture; // distance to the nearest analytic light, at most u_lightReach
+uniform int       u_lightCount;
+
+uniform sampler2D u_feedbackTexture;     // last frame's cascade 0 radiance
+uniform float     u_bounceAlbedo;        // albedo of black paint, 0 turns the feedback off
+
+uniform int       u_cullProbes;          // skip the rays of probes buried in paint
+uniform int       u_countCulledProbes;
+layout(binding = 0, offset = 0) uniform atomic_uint culledProbes;
+
+layout(std430, binding = 1) readonly buffer Occupancy {
+    uint occupancy[];   // one bit per tile, set when the tile holds paint; rows padded to whole words
+};
 
 #define PI 3.1415926f
 #define TAU 2.0f * PI
-#define srgb 1.0f // make 2.2 to enable correct srgb (will reveal artifacts)
 
 float brushRadius = 0.25f / min(u_resolution.x, u_resolution.y);
 
@@ -41,65 +68,228 @@ bool outOfBounds(vec2 uv) {
     return min(uv.x, uv.y) < 0.0f || max(uv.x, uv.y) > 1.0f;
 }
 
+float sampleDistance(vec2 uv) {
+    if (u_distanceFromSeed == 1) {
+        vec2 nearestSeed = texture(u_jfaTexture, uv).xy;
+        float dist = clamp(distance(uv, nearestSeed), 0.0f, 1.0f);
+        if (u_signedField == 1) {
+            vec2 nearestEmpty = texture(u_jfaInteriorTexture, uv).xy;
+            dist -= clamp(distance(uv, nearestEmpty), 0.0f, 1.0f);
+        }
+        return dist;
+    }
+    return textureLod(u_distanceFieldTexture, uv, 0.0f).x;
+}
+
+// Distance (in the units rays advance by) to the exit of the largest pyramid tile around pos
+// that holds no occluder, or 0 when even the finest one does. Everything inside such a tile is
+// free space, so jumping to its border is conservative however close the nearest occluder is
+float emptyTileExit(vec2 pos, vec2 direction, float hitDistance) {
+    for (int level = u_distanceMipLevels; level > 0; level--) {
+        if (textureLod(u_distanceFieldTexture, pos, float(level)).x <= hitDistance) continue;
+
+        vec2 tileSize = exp2(float(level)) / vec2(u_resolution);
+        vec2 tileMin  = floor(pos / tileSize) * tileSize;
+        vec2 border   = tileMin + step(0.0f, direction) * tileSize;
+        vec2 exits    = (border - pos) / max(abs(direction), vec2(1e-6f)) * sign(direction);
+        exits         = mix(exits, vec2(1e6f), lessThan(abs(direction), vec2(1e-6f)));
+
+        // Land a quarter texel past the border, inside the next tile
+        return min(exits.x, exits.y) + 0.25f / max(u_resolution.x, u_resolution.y);
+    }
+    return 0.0f;
+}
+
+// Paint plus the analytic lights splatted over it
+vec4 sampleEmission(vec2 uv) {
+    vec4 paint = texture(u_canvasTexture, uv);
+    if (u_lightCount == 0) return paint;
+
+    vec4 light = texture(u_lightTexture, uv);
+    return vec4(paint.rgb + light.rgb, max(paint.a, light.a));
+}
+
+// Light a hit surface reflects, taken from last frame's radiance a couple of texels back along the
+// ray (texels inside paint hold its own color, not what reaches it). Feeding it back every frame
+// adds one more bounce per frame; emissive paint and lights reflect less the brighter they are
+vec3 reflectedLight(vec2 hitUv, vec2 rayStep, vec4 emission) {
+    float albedo = u_bounceAlbedo * emission.a * (1.0f - clamp(max(emission.r, max(emission.g, emission.b)), 0.0f, 1.0f));
+    if (albedo <= 0.0f) return vec3(0.0f);
+
+    vec2 frontUv = hitUv - rayStep * (2.0f / min(u_resolution.x, u_resolution.y));
+    return albedo * texture(u_feedbackTexture, frontUv).rgb;
+}
+
+// Light leaving the surface a ray hit at hitUv: what it emits plus, with the bounce feedback on,
+// what it reflects back along the ray. Every path that ends a ray on paint goes through here
+vec4 hitLight(vec2 hitUv, vec2 rayStep) {
+    vec4 emission = sampleEmission(hitUv);
+    if (u_bounceAlbedo > 0.0f) emission.rgb += reflectedLight(hitUv, rayStep, emission);
+    return emission;
+}
+
+// Direction of a probe's ray: its group's direction rotated by the ray's place within the group
+vec2 rayDirectionAt(vec2 groupDirection, int i) {
+    vec2 rotation = rayDirections[u_rayDirectionOffset + i];
+    return vec2(groupDirection.x * rotation.x - groupDirection.y * rotation.y,
+                groupDirection.x * rotation.y + groupDirection.y * rotation.x);
+}
+
+// A lower bound of the distance to the nearest analytic light. The occupancy mask, the distance
+// field and its pyramid only know the canvas, so every step is also kept within this
+float sampleLightDistance(vec2 uv) {
+    if (u_lightCount == 0) return 1e6f;
+    return texture(u_lightDistanceTexture, uv).x;
+}
+
+bool tileOccupied(ivec2 tile, ivec2 tileCount) {
+    if (any(lessThan(tile, ivec2(0))) || any(greaterThanEqual(tile, tileCount))) return true;
+
+    int rowWords = (tileCount.x + 31) / 32;
+    return ((occupancy[tile.y * rowWords + (tile.x >> 5)] >> uint(tile.x & 31)) & 1u) != 0u;
+}
+
+// Distance (in the units rays advance by) pos can travel through consecutive empty occupancy
+// tiles, walking the tile grid with a DDA, before it enters an occupied one or covers
+// maxDistance; 0 when pos already is in an occupied tile. Reads one bit per tile instead of
+// fetching the distance field at every step
+float emptyTileRun(vec2 pos, vec2 direction, float maxDistance) {
+    vec2  tileUv    = float(u_occupancyTileSize) / vec2(u_resolution);
+    ivec2 tileCount = (u_resolution + u_occupancyTileSize - 1) / u_occupancyTileSize;
+    ivec2 tile      = ivec2(floor(pos / tileUv));
+    ivec2 tileStep  = ivec2(sign(direction));
+
+    vec2  invDirection = 1.0f / max(abs(direction), vec2(1e-6f));
+    vec2  exits        = abs((vec2(tile) + step(0.0f, direction)) * tileUv - pos) * invDirection;
+    vec2  delta        = tileUv * invDirection;
+
+    float run = 0.0f;
+    for (int i = 0; i < 32 && run < maxDistance && !tileOccupied(tile, tileCount); i++) {
+        run = min(exits.x, exits.y);
+        if (exits.x < exits.y) {
+            tile.x  += tileStep.x;
+            exits.x += delta.x;
+        }
+        else {
+            tile.y  += tileStep.y;
+            exits.y += delta.y;
+        }
+    }
+
+    // Land a quarter texel past the last border, inside the occupied tile
+    return (run > 0.0f) ? run + 0.25f / max(u_resolution.x, u_resolution.y) : 0.0f;
+}
+
 vec4 raymarch() {
     int  maxSteps           = 16;
     vec4 radiance           = vec4(0.0f);
 
-    vec2  fixedUv           = (uv + 1.0f) / 2.0f;
-    vec2  coord             = floor(fixedUv * u_resolution);
-    float rayCount          = pow(u_baseRayCount, u_cascadeIndex + 1);
-    float sqrtBase          = sqrt(float(u_baseRayCount));
-    float spacing           = pow(sqrtBase, u_cascadeIndex);
-    vec2  size              = floor(u_resolution / spacing);
+    // Probe addressing is exact integer math: the ray count is a power of four, so every
+    // spacing and ray count is a shift (sqrtBase = 1 << spacingShift)
+    int   rayShift          = findMSB(u_baseRayCount);
+    int   spacingShift      = rayShift / 2;
+
+    ivec2 coord             = ivec2(gl_FragCoord.xy);
+    int   spacing           = 1 << (spacingShift * u_cascadeIndex);
+    ivec2 size              = u_resolution / spacing;
     
-    vec2  rayPos            = floor(coord / size);
-    float baseIndex         = float(u_baseRayCount) * (rayPos.x + (spacing * rayPos.y));
-    float angleStepSize     = TAU / float(rayCount);
+    // Sides that aren't a multiple of the spacing leave a strip of texels past the last block of
+    // probes. Nothing merges them, but their group index must stay within this cascade's table
+    ivec2 rayPos            = min(coord / size, ivec2(spacing - 1));
+    int   groupIndex        = rayPos.x + spacing * rayPos.y;
+    int   baseIndex         = groupIndex << rayShift;
     float minStepSize       = (0.5f/max(u_resolution.x, u_resolution.y));
     
-    vec2  probeRelativePos  = mod(coord, size);
-    vec2  probeCenter       = (probeRelativePos + 0.5f) * spacing;
+    ivec2 probeRelativePos  = coord % size;
+    vec2  probeCenter       = (vec2(probeRelativePos) + 0.5f) * float(spacing);
 
     float shortestSide      = min(u_resolution.x, u_resolution.y);
     vec2  scale             = shortestSide / u_resolution;
 
-    float intervalStart     = u_cascadeIndex == 0 ? 0.0f : pow(u_baseRayCount, u_cascadeIndex - 1.0f) / shortestSide * 5;
-    float intervalLength    = pow(u_baseRayCount, u_cascadeIndex) / shortestSide * 5;
+    float intervalStart     = u_cascadeIndex == 0 ? 0.0f : float(1 << (rayShift * (u_cascadeIndex - 1))) / shortestSide * 5;
+    float intervalLength    = float(1 << (rayShift * u_cascadeIndex)) / shortestSide * 5;
+
+    vec2  groupDirection    = rayDirections[u_rayDirectionOffset + u_baseRayCount + groupIndex];
+
+    // A probe buried in paint deeper than its interval start has every ray start inside an
+    // occluder, so each returns the paint it starts in and never merges: skip the marching and
+    // let every ray hit the probe center. Only a signed field tells how deep a probe is buried, an
+    // unsigned one still culls probes on paint at cascade 0, whose intervals start at the center
+    if (u_cullProbes == 1) {
+        vec2  probeUv        = probeCenter / vec2(u_resolution);
+        float centerDistance = sampleDistance(probeUv);
+        bool  buried         = (u_cascadeIndex == 0) ? centerDistance <= minStepSize
+                                                     : u_signedField == 1 && centerDistance < -intervalStart;
+        if (buried) {
+            if (u_countCulledProbes == 1) atomicCounterIncrement(culledProbes);
+
+            // Without the feedback every ray brings back the same light, what they reflect
+            // depends on their direction
+            if (u_bounceAlbedo == 0.0f) return vec4(sampleEmission(probeUv).rgb, 1.0f);
+            for (int i = 0; i < u_baseRayCount; i++) {
+                radiance += hitLight(probeUv, rayDirectionAt(groupDirection, i) * scale);
+            }
+            return vec4(radiance.rgb / float(u_baseRayCount), 1.0);
+        }
+    }
 
     for (int i = 0; i < u_baseRayCount; i++) {
-        float index         = baseIndex + float(i);
-        float angleStep     = index + 0.5f;
-        float angle         = angleStepSize * angleStep;
-        vec2  rayDirection  = vec2(cos(angle), -sin(angle));
+        int   index         = baseIndex + i;
+        vec2  rayDirection  = rayDirectionAt(groupDirection, i);
         
         vec2  sampleUv      = (probeCenter / u_resolution) + rayDirection * intervalStart * scale;
         float traveled      = 0.0f;
         vec4  radDelta      = vec4(0.0f);
         bool  dontStart     = outOfBounds(sampleUv);
 
+        // An interval starting inside an occluder is blocked right away, no need to march it
+        if (u_signedField == 1 && !dontStart && sampleDistance(sampleUv) < 0.0f) {
+            radiance += hitLight(sampleUv, rayDirection * scale);
+            continue;
+        }
+
         for (int step = 1; step < maxSteps && !dontStart; step++) {
-            float dist = texture(u_distanceFieldTexture, sampleUv).x;
-            sampleUv += rayDirection * dist * scale;
+            float lightDist = sampleLightDistance(sampleUv);
+
+            // Empty tiles are crossed in one step without touching the distance field
+            if (u_occupancyTileSize > 0 && lightDist > minStepSize) {
+                float run = min(emptyTileRun(sampleUv, rayDirection * scale, intervalLength - traveled), lightDist);
+                if (run > 0.0f) {
+                    sampleUv += rayDirection * run * scale;
+                    traveled += run;
+                    if (outOfBounds(sampleUv) || traveled >= intervalLength) break;
+                    continue;
+                }
+            }
+
+            float dist = min(sampleDistance(sampleUv), lightDist);
+
+            // Upper cascades march long intervals, let them jump across empty pyramid tiles
+            float stepSize = max(dist, 0.0f);
+            if (u_cascadeIndex > 0 && dist > minStepSize) {
+                stepSize = max(stepSize, min(emptyTileExit(sampleUv, rayDirection * scale, minStepSize), lightDist));
+            }
+            sampleUv += rayDirection * stepSize * scale;
             
             if (outOfBounds(sampleUv)) break;
             
             if (dist <= minStepSize) {
-                vec4 sampleLight = texture(u_canvasTexture, sampleUv);
-                radDelta += vec4(pow(sampleLight.rgb, vec3(srgb)), sampleLight.a);
+                radDelta += hitLight(sampleUv, rayDirection * scale);
                 break;
             }
 
-            traveled += dist;
+            traveled += stepSize;
             if (traveled >= intervalLength) break;
         }
 
         if ((u_cascadeIndex < (u_cascadeCount - 1)) && (radDelta.a == 0.0f)) {
-            float upperSpacing  = pow(sqrtBase, u_cascadeIndex + 1.0f);
-            vec2  upperSize     = floor(u_resolution / upperSpacing);
-            vec2  upperPosition = vec2(mod(index, upperSpacing), floor(index / upperSpacing)) * upperSize;
-            vec2  offset        = (probeRelativePos + 0.5f) / sqrtBase;
-            vec2  clampedOffset = clamp(offset, vec2(0.5f), upperSize - 0.5f);
-            vec2  upperUv       = (upperPosition + clampedOffset) / u_resolution;
+            // Still a filtered fetch: the merge interpolates between the four nearest upper probes
+            int   upperSpacing  = spacing << spacingShift;
+            ivec2 upperSize     = u_resolution / upperSpacing;
+            ivec2 upperPosition = ivec2(index & (upperSpacing - 1), index >> (spacingShift * (u_cascadeIndex + 1))) * upperSize;
+            vec2  offset        = (vec2(probeRelativePos) + 0.5f) / float(1 << spacingShift);
+            vec2  clampedOffset = clamp(offset, vec2(0.5f), vec2(upperSize) - 0.5f);
+            vec2  upperUv       = (vec2(upperPosition) + clampedOffset) / vec2(u_resolution);
             radDelta += texture(u_lastTexture, upperUv);
         }
         
@@ -118,5 +308,6 @@ void main() {
     else {
         radiance = raymarch();
     }
-    FragColor = vec4((u_cascadeIndex > 0) ? radiance.rgb : pow(radiance.rgb, vec3(1.0 / srgb)), 1.0);
+    // sRGB decoding of the canvas and encoding of the final image happen in hardware (SRGB_CANVAS)
+    FragColor = vec4(radiance.rgb, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include"readback.h"
+
+FrameReadback::FrameReadback(int width, int height, Callback callback) : width(width), height(height), callback(callback), next(0), oldest(0) {
+	glGenBuffers(RING_SIZE, buffers);
+	for (int i = 0; i < RING_SIZE; i++) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+		fences[i] = NULL;
+		frames[i] = 0;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameReadback::capture(unsigned int frame) {
+	// All slots in flight: the oldest frame is RING_SIZE frames old and almost surely done
+	if (fences[next] != NULL) {
+		deliver(next, true);
+		oldest = (next + 1) % RING_SIZE;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[next]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	fences[next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frames[next] = frame;
+	next = (next + 1) % RING_SIZE;
+}
+
+void FrameReadback::poll() {
+	// Frames complete in order, so stop at the first one that is still being copied
+	while (fences[oldest] != NULL && deliver(oldest, false)) {
+		oldest = (oldest + 1) % RING_SIZE;
+	}
+}
+
+void FrameReadback::flush() {
+	while (fences[oldest] != NULL) {
+		deliver(oldest, true);
+		oldest = (oldest + 1) % RING_SIZE;
+	}
+}
+
+bool FrameReadback::deliver(int slot, bool wait) {
+	if (!wait) {
+		GLint status = GL_UNSIGNALED;
+		glGetSynciv(fences[slot], GL_SYNC_STATUS, 1, NULL, &status);
+		if (status != GL_SIGNALED) return false;
+	}
+	else {
+		while (glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+	}
+	glDeleteSync(fences[slot]);
+	fences[slot] = NULL;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[slot]);
+	const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)width * height * 4, GL_MAP_READ_BIT);
+	if (pixels) {
+		callback(frames[slot], pixels, width, height);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return true;
+}
+
+void FrameReadback::deleteReadback() {
+	flush();
+	glDeleteBuffers(RING_SIZE, buffers);
+}
@@ -0,0 +1,35 @@
+#ifndef READBACK_CLASS_H
+#define READBACK_CLASS_H
+
+#include<glad/glad.h>
+#include<cstddef>
+#include<functional>
+
+// Reads rendered frames back through a ring of pixel-pack buffers. capture() only queues an
+// asynchronous glReadPixels and a fence; the frame is mapped and handed to the callback a few
+// frames later, once its fence has signaled, so the render thread never waits on the GPU
+class FrameReadback {
+public:
+	// pixels: RGBA8, bottom row first, only valid during the call
+	typedef std::function<void(unsigned int frame, const unsigned char* pixels, int width, int height)> Callback;
+
+	FrameReadback(int width, int height, Callback callback);
+
+	void capture(unsigned int frame);	// reads the currently bound read framebuffer
+	void poll();				// delivers every frame whose copy has completed
+	void flush();				// waits for and delivers all frames still in flight
+	void deleteReadback();
+private:
+	static const int RING_SIZE = 3;
+	int width, height;
+	Callback callback;
+	GLuint buffers[RING_SIZE];
+	GLsync fences[RING_SIZE];		// NULL when the slot holds no frame
+	unsigned int frames[RING_SIZE];
+	int next;				// slot the next capture writes to
+	int oldest;				// slot of the oldest frame in flight
+
+	bool deliver(int slot, bool wait);	// false when not waiting and the copy is still running
+};
+
+#endif
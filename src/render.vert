@@ -1,5 +1,3 @@
-// Not in use right now
-
 #version 430 core
 
 layout (location = 0) in vec3 aPos;
@@ -0,0 +1,129 @@
+#include"scenes.h"
+
+#include<cmath>
+#include<cstring>
+#include<algorithm>
+
+// Writes a capsule from (x0, y0) to (x1, y1) of the given radius, all in texels
+static void paintSegment(std::vector<float>& canvas, int width, int height,
+	float x0, float y0, float x1, float y1, float radius, float r, float g, float b) {
+	const int minX = std::max(0, int(std::floor(std::min(x0, x1) - radius)));
+	const int maxX = std::min(width - 1, int(std::ceil(std::max(x0, x1) + radius)));
+	const int minY = std::max(0, int(std::floor(std::min(y0, y1) - radius)));
+	const int maxY = std::min(height - 1, int(std::ceil(std::max(y0, y1) + radius)));
+
+	const float lineX = x1 - x0, lineY = y1 - y0;
+	const float lineLengthSquared = std::max(lineX * lineX + lineY * lineY, 1e-6f);
+
+	for (int y = minY; y <= maxY; y++) {
+		for (int x = minX; x <= maxX; x++) {
+			const float px = x + 0.5f - x0, py = y + 0.5f - y0;
+			const float t = std::min(std::max((px * lineX + py * lineY) / lineLengthSquared, 0.0f), 1.0f);
+			const float dx = px - lineX * t, dy = py - lineY * t;
+			if (dx * dx + dy * dy > radius * radius) continue;
+
+			float* texel = &canvas[(y * width + x) * 4];
+			texel[0] = r;
+			texel[1] = g;
+			texel[2] = b;
+			texel[3] = 1.0f;
+		}
+	}
+}
+
+static void paintEmpty(std::vector<float>&, int, int) {
+}
+
+static void paintSparseLights(std::vector<float>& canvas, int width, int height) {
+	const float lights[][5] = {
+		// x, y (fraction of the canvas), r, g, b
+		{ 0.20f, 0.25f, 1.0f, 0.6f, 0.2f },
+		{ 0.75f, 0.30f, 0.2f, 0.6f, 1.0f },
+		{ 0.50f, 0.55f, 1.0f, 1.0f, 1.0f },
+		{ 0.15f, 0.80f, 0.3f, 1.0f, 0.4f },
+		{ 0.85f, 0.85f, 1.0f, 0.3f, 0.8f },
+	};
+	const float radius = 0.01f * std::min(width, height);
+	for (const float* light : lights) {
+		const float x = light[0] * width, y = light[1] * height;
+		paintSegment(canvas, width, height, x, y, x, y, radius, light[2], light[3], light[4]);
+	}
+
+	// A couple of walls so the lights cast shadows
+	paintSegment(canvas, width, height, 0.35f * width, 0.35f * height, 0.35f * width, 0.70f * height, radius * 0.5f, 0.0f, 0.0f, 0.0f);
+	paintSegment(canvas, width, height, 0.60f * width, 0.70f * height, 0.80f * width, 0.60f * height, radius * 0.5f, 0.0f, 0.0f, 0.0f);
+}
+
+static void paintDenseMaze(std::vector<float>& canvas, int width, int height) {
+	const int cell = std::max(8, std::min(width, height) / 20);
+	const float wall = cell * 0.1f;
+
+	// Fixed LCG so every run builds the same maze
+	unsigned int state = 12345u;
+	auto next = [&state]() {
+		state = state * 1664525u + 1013904223u;
+		return state >> 16;
+	};
+
+	for (int y = 0; y <= height; y += cell) {
+		for (int x = 0; x <= width; x += cell) {
+			const unsigned int r = next();
+			if (r & 1) paintSegment(canvas, width, height, float(x), float(y), float(x + cell), float(y), wall, 0.0f, 0.0f, 0.0f);
+			if (r & 2) paintSegment(canvas, width, height, float(x), float(y), float(x), float(y + cell), wall, 0.0f, 0.0f, 0.0f);
+			if ((r & 0x3c) == 0) {
+				const float cx = x + cell * 0.5f, cy = y + cell * 0.5f;
+				paintSegment(canvas, width, height, cx, cy, cx, cy, cell * 0.15f, (r >> 6 & 3) / 3.0f, (r >> 8 & 3) / 3.0f, 1.0f);
+			}
+		}
+	}
+}
+
+static void paintFullscreenLight(std::vector<float>& canvas, int, int) {
+	for (size_t i = 0; i < canvas.size(); i += 4) {
+		canvas[i + 0] = 1.0f;
+		canvas[i + 1] = 0.9f;
+		canvas[i + 2] = 0.8f;
+		canvas[i + 3] = 1.0f;
+	}
+}
+
+const Scene SCENES[] = {
+	{ "empty", 800, 800, paintEmpty },
+	{ "sparse_lights", 800, 800, paintSparseLights },
+	{ "dense_maze", 800, 800, paintDenseMaze },
+	{ "fullscreen_light", 800, 800, paintFullscreenLight },
+	{ "canvas_4k", 3840, 2160, paintSparseLights },
+};
+const int SCENE_COUNT = sizeof(SCENES) / sizeof(SCENES[0]);
+
+const Scene* findScene(const char* name) {
+	for (int i = 0; i < SCENE_COUNT; i++) {
+		if (strcmp(SCENES[i].name, name) == 0) return &SCENES[i];
+	}
+	return nullptr;
+}
+
+void paintGrid(std::vector<float>& canvas, int width, int height) {
+	// Dots at the quarter points, 0.0173 uv (sqrt(0.0003)) in radius
+	const float radiusSquared = 0.0003f;
+	const float radius = std::sqrt(radiusSquared);
+
+	for (int i = 1; i < 4; i++) {
+		for (int j = 1; j < 4; j++) {
+			const float centerU = i / 4.0f, centerV = j / 4.0f;
+			const int minX = std::max(0, int((centerU - radius) * width)), maxX = std::min(width - 1, int((centerU + radius) * width));
+			const int minY = std::max(0, int((centerV - radius) * height)), maxY = std::min(height - 1, int((centerV + radius) * height));
+
+			for (int y = minY; y <= maxY; y++) {
+				for (int x = minX; x <= maxX; x++) {
+					const float du = (x + 0.5f) / width - centerU, dv = (y + 0.5f) / height - centerV;
+					float* texel = &canvas[(y * width + x) * 4];
+					if (du * du + dv * dv >= radiusSquared || texel[3] >= 0.1f) continue;
+
+					texel[0] = texel[1] = texel[2] = 0.0f;
+					texel[3] = 1.0f;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,22 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include<vector>
+
+// Canned canvases for benchmarks: float RGBA texels, bottom row first, rgb is emitted light and
+// alpha marks occluders like the brush writes them
+struct Scene {
+	const char* name;
+	int width, height;
+	void (*paint)(std::vector<float>& canvas, int width, int height);
+};
+
+extern const Scene SCENES[];
+extern const int SCENE_COUNT;
+
+const Scene* findScene(const char* name);
+
+// The 3x3 grid of small occluders every canvas starts with, painted where the canvas is empty
+void paintGrid(std::vector<float>& canvas, int width, int height);
+
+#endif
@@ -41,6 +41,23 @@ Shader::Shader(const char* vertexFile, const char* fragmentFile) {
 	glDeleteShader(fragmentShader);
 }
 
+Shader::Shader(const char* computeFile) {
+	std::string computeCode = getFileContents(computeFile);
+	const char* computeSource = computeCode.c_str();
+
+	GLuint computeShader = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(computeShader, 1, &computeSource, NULL);
+	glCompileShader(computeShader);
+	compileErrors(computeShader, "COMPUTE");
+
+	ID = glCreateProgram();
+	glAttachShader(ID, computeShader);
+	glLinkProgram(ID);
+	compileErrors(ID, "PROGRAM");
+
+	glDeleteShader(computeShader);
+}
+
 void Shader::activateShader() {
 	glUseProgram(ID);
 }
@@ -14,6 +14,7 @@ class Shader {
 public:
 	GLuint ID;
 	Shader(const char* vertexShaderFile, const char* fragmentShaderFile);
+	Shader(const char* computeShaderFile);
 
 	void activateShader();
 	void dectivateShader();
@@ -0,0 +1,326 @@
+#include"snapshot.h"
+
+#include<algorithm>
+#include<cstring>
+#include<fstream>
+#include<iostream>
+#ifdef _WIN32
+#define NOMINMAX
+#include<windows.h>
+#else
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+
+static const uint32_t SNAPSHOT_VERSION = 1;
+static const size_t HEADER_SIZE = 20;
+static const size_t CHUNK_HEADER_SIZE = 16;
+static const uint32_t RUN_FLAG = 0x80000000u;
+static const size_t MAX_PACKET = 0x7fffffff;
+
+// Run-length encoding on 32-bit words: a packet word with the top bit set repeats the next
+// word, otherwise it counts the literal words that follow. Empty canvas regions, which are
+// most of a typical canvas, collapse to a couple of words
+static void compressWords(const uint32_t* words, size_t count, std::vector<uint32_t>& out) {
+	size_t i = 0;
+	while (i < count) {
+		size_t run = 1;
+		while (i + run < count && words[i + run] == words[i] && run < MAX_PACKET) run++;
+		if (run >= 3) {
+			out.push_back(RUN_FLAG | uint32_t(run));
+			out.push_back(words[i]);
+			i += run;
+			continue;
+		}
+
+		// Literals up to the start of the next run of three
+		const size_t start = i;
+		while (i < count && i - start < MAX_PACKET && !(i + 2 < count && words[i] == words[i + 1] && words[i] == words[i + 2])) i++;
+		out.push_back(uint32_t(i - start));
+		out.insert(out.end(), words + start, words + i);
+	}
+}
+
+static bool decompressWords(const uint32_t* in, size_t inCount, uint32_t* out, size_t outCount) {
+	size_t read = 0, written = 0;
+	while (read < inCount) {
+		const uint32_t packet = in[read++];
+		const size_t length = packet & ~RUN_FLAG;
+		if (written + length > outCount) return false;
+
+		if (packet & RUN_FLAG) {
+			if (read >= inCount) return false;
+			std::fill(out + written, out + written + length, in[read++]);
+		}
+		else {
+			if (read + length > inCount) return false;
+			std::copy(in + read, in + read + length, out + written);
+			read += length;
+		}
+		written += length;
+	}
+	return written == outCount;
+}
+
+// Read-only memory mapping of a whole file
+struct MappedFile {
+	const unsigned char* data = NULL;
+	size_t size = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int file = -1;
+#endif
+};
+
+static void unmapFile(MappedFile& mapped) {
+#ifdef _WIN32
+	if (mapped.data) UnmapViewOfFile(mapped.data);
+	if (mapped.mapping) CloseHandle(mapped.mapping);
+	if (mapped.file != INVALID_HANDLE_VALUE) CloseHandle(mapped.file);
+#else
+	if (mapped.data) munmap((void*)mapped.data, mapped.size);
+	if (mapped.file >= 0) close(mapped.file);
+#endif
+	mapped = MappedFile();
+}
+
+static bool mapFile(const char* filename, MappedFile& mapped) {
+#ifdef _WIN32
+	mapped.file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER size;
+	if (mapped.file == INVALID_HANDLE_VALUE || !GetFileSizeEx(mapped.file, &size) || size.QuadPart == 0) {
+		unmapFile(mapped);
+		return false;
+	}
+	mapped.size = (size_t)size.QuadPart;
+	mapped.mapping = CreateFileMappingA(mapped.file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapped.mapping) mapped.data = (const unsigned char*)MapViewOfFile(mapped.mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	mapped.file = open(filename, O_RDONLY);
+	struct stat status;
+	if (mapped.file < 0 || fstat(mapped.file, &status) != 0 || status.st_size == 0) {
+		unmapFile(mapped);
+		return false;
+	}
+	mapped.size = (size_t)status.st_size;
+	void* data = mmap(NULL, mapped.size, PROT_READ, MAP_PRIVATE, mapped.file, 0);
+	if (data != MAP_FAILED) mapped.data = (const unsigned char*)data;
+#endif
+	if (mapped.data == NULL) {
+		unmapFile(mapped);
+		return false;
+	}
+	return true;
+}
+
+static uint32_t readWord(const unsigned char* data) {
+	uint32_t word;
+	memcpy(&word, data, sizeof(word));
+	return word;
+}
+
+bool snapshotSize(const char* filename, int& width, int& height) {
+	std::ifstream in(filename, std::ios::binary);
+	unsigned char header[HEADER_SIZE];
+	if (!in.read((char*)header, HEADER_SIZE) || memcmp(header, "RCSN", 4) != 0) return false;
+
+	width = (int)readWord(header + 8);
+	height = (int)readWord(header + 12);
+	return true;
+}
+
+bool loadSnapshot(const char* filename, Snapshot& snapshot) {
+	MappedFile mapped;
+	if (!mapFile(filename, mapped)) {
+		std::cout << "Error: Could not open snapshot " << filename << std::endl;
+		return false;
+	}
+
+	bool valid = mapped.size >= HEADER_SIZE && memcmp(mapped.data, "RCSN", 4) == 0 && readWord(mapped.data + 4) == SNAPSHOT_VERSION;
+	if (valid) {
+		snapshot.width = (int)readWord(mapped.data + 8);
+		snapshot.height = (int)readWord(mapped.data + 12);
+		snapshot.canvas.clear();
+		snapshot.distance.clear();
+		snapshot.signedDistance = false;
+		snapshot.emission.clear();
+		snapshot.emissionStrokes.clear();
+
+		const uint32_t chunkCount = readWord(mapped.data + 16);
+		const size_t texels = (size_t)snapshot.width * snapshot.height;
+		size_t offset = HEADER_SIZE;
+
+		for (uint32_t i = 0; i < chunkCount && valid; i++) {
+			if (offset + CHUNK_HEADER_SIZE > mapped.size) {
+				valid = false;
+				break;
+			}
+			const unsigned char* chunk = mapped.data + offset;
+			const uint32_t flags = readWord(chunk + 4);
+			const size_t rawSize = readWord(chunk + 8);
+			const size_t compressedSize = readWord(chunk + 12);
+			offset += CHUNK_HEADER_SIZE;
+			if (offset + compressedSize > mapped.size || compressedSize % 4 != 0) {
+				valid = false;
+				break;
+			}
+
+			// Chunks start at multiples of four bytes into the page aligned mapping
+			const uint32_t* words = (const uint32_t*)(mapped.data + offset);
+			uint32_t* target = NULL;
+			if (memcmp(chunk, "CANV", 4) == 0 && rawSize == texels * 4 * sizeof(float)) {
+				snapshot.canvas.resize(rawSize / sizeof(float));
+				target = (uint32_t*)snapshot.canvas.data();
+			}
+			else if (memcmp(chunk, "DIST", 4) == 0 && rawSize == texels * sizeof(float)) {
+				snapshot.distance.resize(rawSize / sizeof(float));
+				target = (uint32_t*)snapshot.distance.data();
+				snapshot.signedDistance = (flags & 1) != 0;
+			}
+			else if (memcmp(chunk, "EMIT", 4) == 0 && rawSize > 0 && rawSize % sizeof(Capsule) == 0) {
+				snapshot.emission.resize(rawSize / sizeof(Capsule));
+				target = (uint32_t*)snapshot.emission.data();
+			}
+			else if (memcmp(chunk, "EMST", 4) == 0 && rawSize > 0 && rawSize % sizeof(uint32_t) == 0) {
+				snapshot.emissionStrokes.resize(rawSize / sizeof(uint32_t));
+				target = snapshot.emissionStrokes.data();
+			}
+
+			if (target) valid = decompressWords(words, compressedSize / 4, target, rawSize / 4);
+			offset += compressedSize;
+		}
+		valid = valid && !snapshot.canvas.empty();
+
+		// Strokes start in painting order, within the capsules
+		for (size_t i = 0; i < snapshot.emissionStrokes.size() && valid; i++) {
+			valid = snapshot.emissionStrokes[i] <= snapshot.emission.size() && (i == 0 || snapshot.emissionStrokes[i - 1] <= snapshot.emissionStrokes[i]);
+		}
+	}
+	unmapFile(mapped);
+
+	if (!valid) std::cout << "Error: " << filename << " is not a valid snapshot" << std::endl;
+	return valid;
+}
+
+SnapshotSaver::SnapshotSaver() : fence(NULL), writing(false) {
+	glGenBuffers(2, buffers);
+}
+
+bool SnapshotSaver::busy() const {
+	return fence != NULL || writing;
+}
+
+void SnapshotSaver::requestSave(const std::string& filename, GLuint canvasTexture, GLuint distanceTexture, bool signedDistance, int width, int height, const StrokeBuffer& emission) {
+	if (busy()) {
+		std::cout << "Still saving the previous snapshot" << std::endl;
+		return;
+	}
+	this->filename = filename;
+	pending.width = width;
+	pending.height = height;
+	pending.signedDistance = signedDistance;
+	pending.canvas.assign((size_t)width * height * 4, 0.0f);
+	pending.distance.assign(distanceTexture ? (size_t)width * height : 0, 0.0f);
+	pending.emission = emission.capsules;
+	pending.emissionStrokes.clear();
+	for (size_t i = 0; i < emission.strokeStarts.size(); i++) {
+		// Presses that painted nothing leave empty strokes behind, which undo skips anyway
+		const size_t end = (i + 1 < emission.strokeStarts.size()) ? emission.strokeStarts[i + 1] : emission.capsules.size();
+		if (emission.strokeStarts[i] < end) pending.emissionStrokes.push_back(uint32_t(emission.strokeStarts[i]));
+	}
+
+	// Texture reads into a bound pixel-pack buffer return immediately; unit 5 is scratch
+	glActiveTexture(GL_TEXTURE5);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[0]);
+	glBufferData(GL_PIXEL_PACK_BUFFER, pending.canvas.size() * sizeof(float), NULL, GL_STREAM_READ);
+	glBindTexture(GL_TEXTURE_2D, canvasTexture);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, (void*)0);
+
+	if (distanceTexture) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[1]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, pending.distance.size() * sizeof(float), NULL, GL_STREAM_READ);
+		glBindTexture(GL_TEXTURE_2D, distanceTexture);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, (void*)0);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void SnapshotSaver::poll() {
+	if (fence == NULL) return;
+
+	GLint status = GL_UNSIGNALED;
+	glGetSynciv(fence, GL_SYNC_STATUS, 1, NULL, &status);
+	if (status != GL_SIGNALED) return;
+	glDeleteSync(fence);
+	fence = NULL;
+
+	std::vector<float>* targets[] = { &pending.canvas, &pending.distance };
+	for (int i = 0; i < 2; i++) {
+		if (targets[i]->empty()) continue;
+
+		const GLsizeiptr size = targets[i]->size() * sizeof(float);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers[i]);
+		const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+		if (pixels) {
+			memcpy(targets[i]->data(), pixels, size);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (thread.joinable()) thread.join();
+	writing = true;
+	thread = std::thread(&SnapshotSaver::write, this);
+}
+
+void SnapshotSaver::write() {
+	std::ofstream out(filename, std::ios::binary);
+	if (!out) {
+		std::cout << "Error: Could not write snapshot " << filename << std::endl;
+		writing = false;
+		return;
+	}
+
+	const bool hasEmission = !pending.emission.empty();
+	const uint32_t chunkCount = 1 + (pending.distance.empty() ? 0 : 1) + (hasEmission ? 2 : 0);
+	const uint32_t header[] = { SNAPSHOT_VERSION, uint32_t(pending.width), uint32_t(pending.height), chunkCount };
+	out.write("RCSN", 4);
+	out.write((const char*)header, sizeof(header));
+
+	auto writeChunk = [&out](const char* tag, uint32_t flags, const void* data, size_t size) {
+		std::vector<uint32_t> compressed;
+		compressWords((const uint32_t*)data, size / sizeof(uint32_t), compressed);
+
+		const uint32_t chunkHeader[] = { flags, uint32_t(size), uint32_t(compressed.size() * sizeof(uint32_t)) };
+		out.write(tag, 4);
+		out.write((const char*)chunkHeader, sizeof(chunkHeader));
+		out.write((const char*)compressed.data(), compressed.size() * sizeof(uint32_t));
+	};
+	writeChunk("CANV", 0, pending.canvas.data(), pending.canvas.size() * sizeof(float));
+	if (!pending.distance.empty()) writeChunk("DIST", pending.signedDistance ? 1 : 0, pending.distance.data(), pending.distance.size() * sizeof(float));
+	if (hasEmission) {
+		writeChunk("EMIT", 0, pending.emission.data(), pending.emission.size() * sizeof(Capsule));
+		writeChunk("EMST", 0, pending.emissionStrokes.data(), pending.emissionStrokes.size() * sizeof(uint32_t));
+	}
+
+	std::cout << "Saved snapshot " << filename << " (" << out.tellp() << " bytes)" << std::endl;
+	writing = false;
+}
+
+void SnapshotSaver::deleteSaver() {
+	if (fence != NULL) {
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+		poll();
+	}
+	if (thread.joinable()) thread.join();
+	glDeleteBuffers(2, buffers);
+}
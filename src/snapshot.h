@@ -0,0 +1,55 @@
+#ifndef SNAPSHOT_CLASS_H
+#define SNAPSHOT_CLASS_H
+
+#include<glad/glad.h>
+#include<atomic>
+#include<cstdint>
+#include<string>
+#include<thread>
+#include<vector>
+
+#include"strokes.h"
+
+// Snapshot file: a 20 byte header ("RCSN", version, width, height, chunk count) followed by
+// chunks of a 16 byte header (tag, flags, raw size, compressed size) and run-length encoded
+// 32-bit words. "CANV" holds the canvas as RGBA floats, the optional "DIST" chunk the R32F
+// distance field (flag bit 0 set when it is signed). The emission layer, which never enters the
+// canvas, is kept as vectors: "EMIT" holds its capsules and "EMST" where each of its strokes starts
+struct Snapshot {
+	int width, height;
+	std::vector<float> canvas;
+	std::vector<float> distance;	// empty when the snapshot has no distance field
+	bool signedDistance;
+	std::vector<Capsule> emission;
+	std::vector<uint32_t> emissionStrokes;	// index of the first capsule of every stroke
+};
+
+// Reads only the header, so the canvas can be sized before the GL context exists
+bool snapshotSize(const char* filename, int& width, int& height);
+
+// Memory maps the file and decodes the chunks straight out of the mapping
+bool loadSnapshot(const char* filename, Snapshot& snapshot);
+
+// Saves without stalling a frame: requestSave() queues the texture reads into pixel-pack
+// buffers, poll() picks them up once their fence has signaled and hands compression and
+// writing to a worker thread
+class SnapshotSaver {
+public:
+	SnapshotSaver();
+
+	bool busy() const;
+	void requestSave(const std::string& filename, GLuint canvasTexture, GLuint distanceTexture, bool signedDistance, int width, int height, const StrokeBuffer& emission);
+	void poll();
+	void deleteSaver();
+private:
+	GLuint buffers[2];		// canvas, distance field
+	GLsync fence;
+	std::string filename;
+	Snapshot pending;
+	std::atomic<bool> writing;
+	std::thread thread;
+
+	void write();
+};
+
+#endif
@@ -1,2 +1,4 @@
 #define STB_IMAGE_IMPLEMENTATION
-#include<stb/stb_image.h>
\ No newline at end of file
+#include<stb/stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include<stb/stb_image_write.h>
\ No newline at end of file
@@ -0,0 +1,29 @@
+#version 430 core
+
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;
+#else
+precision mediump float;
+#endif
+
+in vec2 uv;
+flat in vec4 segment;
+flat in vec4 color;
+flat in float radius;
+
+out vec4 FragColor;
+
+float sdfLineSquared(vec2 p, vec2 from, vec2 to) {
+  vec2 toStart = p - from;
+  vec2 line = to - from;
+  float lineLengthSquared = dot(line, line);
+  float t = (lineLengthSquared > 0.0f) ? clamp(dot(toStart, line) / lineLengthSquared, 0.0, 1.0) : 0.0f;
+  vec2 closestVector = toStart - line * t;
+  return dot(closestVector, closestVector);
+}
+
+void main() {
+    if (sdfLineSquared(uv, segment.xy, segment.zw) > radius * radius) discard;
+
+    FragColor = color;
+}
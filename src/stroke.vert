@@ -0,0 +1,33 @@
+#version 430 core
+
+// One instance per brush capsule: a quad covering the capsule's bounding box
+struct Capsule {
+    vec4 segment;   // start.xy, end.xy in canvas uv
+    vec4 color;
+    vec4 params;    // x: radius in canvas uv
+};
+
+layout(std430, binding = 0) readonly buffer Capsules {
+    Capsule capsules[];
+};
+
+uniform int u_firstCapsule;
+
+out vec2 uv;
+flat out vec4 segment;
+flat out vec4 color;
+flat out float radius;
+
+void main() {
+    Capsule capsule = capsules[u_firstCapsule + gl_InstanceID];
+    segment = capsule.segment;
+    color = capsule.color;
+    radius = capsule.params.x;
+
+    vec2 low = min(segment.xy, segment.zw) - radius;
+    vec2 high = max(segment.xy, segment.zw) + radius;
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    uv = mix(low, high, corner);
+    gl_Position = vec4(uv * 2.0f - 1.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,60 @@
+#include"strokes.h"
+
+StrokeBuffer::StrokeBuffer() : capacity(1024), uploaded(0) {
+	glGenBuffers(1, &ID);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(Capsule), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void StrokeBuffer::beginStroke() {
+	// A press without any segment leaves an empty stroke behind, reuse it
+	if (!strokeStarts.empty() && strokeStarts.back() == capsules.size()) return;
+	strokeStarts.push_back(capsules.size());
+}
+
+void StrokeBuffer::addCapsule(float startX, float startY, float endX, float endY, float radius, const float color[4]) {
+	if (strokeStarts.empty()) strokeStarts.push_back(0);
+
+	Capsule capsule = { { startX, startY, endX, endY }, { color[0], color[1], color[2], color[3] }, { radius, 0.0f, 0.0f, 0.0f } };
+	capsules.push_back(capsule);
+}
+
+bool StrokeBuffer::undoStroke() {
+	while (!strokeStarts.empty() && strokeStarts.back() == capsules.size()) strokeStarts.pop_back();
+	if (strokeStarts.empty()) return false;
+
+	capsules.resize(strokeStarts.back());
+	strokeStarts.pop_back();
+	if (uploaded > capsules.size()) uploaded = capsules.size();
+	return true;
+}
+
+void StrokeBuffer::clearStrokes() {
+	capsules.clear();
+	strokeStarts.clear();
+	uploaded = 0;
+}
+
+void StrokeBuffer::upload() {
+	if (uploaded == capsules.size()) return;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+	if (capsules.size() > capacity) {
+		// Grow geometrically and upload everything again
+		while (capsules.size() > capacity) capacity *= 2;
+		glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(Capsule), NULL, GL_DYNAMIC_DRAW);
+		uploaded = 0;
+	}
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, uploaded * sizeof(Capsule), (capsules.size() - uploaded) * sizeof(Capsule), &capsules[uploaded]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	uploaded = capsules.size();
+}
+
+void StrokeBuffer::bindStrokeBuffer(GLuint binding) {
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, ID);
+}
+
+void StrokeBuffer::deleteStrokeBuffer() {
+	glDeleteBuffers(1, &ID);
+}
@@ -0,0 +1,40 @@
+#ifndef STROKES_CLASS_H
+#define STROKES_CLASS_H
+
+#include<glad/glad.h>
+#include<cstddef>
+#include<vector>
+
+// One brush segment, laid out like the std430 struct in stroke.vert. Positions and radius are
+// in canvas uv, so the strokes rasterize the same at any canvas resolution
+struct Capsule {
+	float segment[4];	// start.xy, end.xy
+	float color[4];
+	float params[4];	// x: radius
+};
+
+// Every brush segment painted so far, mirrored into a shader storage buffer that stroke.vert
+// reads to rasterize them as instanced quads. Segments are grouped into strokes (one press
+// of a mouse button) so the last stroke can be undone
+class StrokeBuffer {
+public:
+	GLuint ID;
+	std::vector<Capsule> capsules;
+	std::vector<size_t> strokeStarts;	// index of the first capsule of every stroke
+
+	StrokeBuffer();
+
+	void beginStroke();
+	void addCapsule(float startX, float startY, float endX, float endY, float radius, const float color[4]);
+	bool undoStroke();	// false when there is nothing to undo
+	void clearStrokes();
+
+	void upload();		// copies the capsules added since the last upload to the GPU
+	void bindStrokeBuffer(GLuint binding);
+	void deleteStrokeBuffer();
+private:
+	size_t capacity;	// in capsules
+	size_t uploaded;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include"timer.h"
+
+GpuTimer::GpuTimer(int passCount) : passMs(passCount, 0.0), collectedFrames(0), passCount(passCount), slot(0),
+	queries(RING_SIZE * passCount), issued(RING_SIZE * passCount, 0) {
+	glGenQueries(RING_SIZE * passCount, queries.data());
+	for (int i = 0; i < RING_SIZE; i++) {
+		pendingCollect[i] = false;
+		pending[i] = false;
+	}
+}
+
+void GpuTimer::beginPass(int pass) {
+	issued[slot * passCount + pass] = 1;
+	glBeginQuery(GL_TIME_ELAPSED, queries[slot * passCount + pass]);
+}
+
+void GpuTimer::endPass() {
+	glEndQuery(GL_TIME_ELAPSED);
+}
+
+void GpuTimer::endFrame(bool collectFrame) {
+	pending[slot] = true;
+	pendingCollect[slot] = collectFrame;
+
+	// The next slot was last used RING_SIZE - 1 frames ago, its results are (almost) surely ready
+	slot = (slot + 1) % RING_SIZE;
+	collect(slot);
+}
+
+void GpuTimer::flush() {
+	for (int i = 0; i < RING_SIZE; i++) {
+		collect((slot + i) % RING_SIZE);
+	}
+}
+
+void GpuTimer::collect(int ringSlot) {
+	if (!pending[ringSlot]) return;
+
+	for (int pass = 0; pass < passCount; pass++) {
+		char& ran = issued[ringSlot * passCount + pass];
+		if (!ran) continue;
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(queries[ringSlot * passCount + pass], GL_QUERY_RESULT, &elapsed);
+		if (pendingCollect[ringSlot]) passMs[pass] += elapsed / 1.0e6;
+		ran = 0;
+	}
+	if (pendingCollect[ringSlot]) collectedFrames++;
+	pending[ringSlot] = false;
+}
+
+void GpuTimer::deleteTimer() {
+	glDeleteQueries(RING_SIZE * passCount, queries.data());
+}
@@ -0,0 +1,33 @@
+#ifndef TIMER_CLASS_H
+#define TIMER_CLASS_H
+
+#include<glad/glad.h>
+#include<vector>
+
+// GPU time per render pass from GL_TIME_ELAPSED queries. Queries rotate through a ring of
+// frames so results are read a few frames later, when they are ready, instead of stalling
+class GpuTimer {
+public:
+	std::vector<double> passMs;	// accumulated over the collected frames
+	long collectedFrames;
+
+	GpuTimer(int passCount);
+
+	void beginPass(int pass);
+	void endPass();
+	void endFrame(bool collect);	// collect: add this frame to passMs once its results arrive
+	void flush();
+	void deleteTimer();
+private:
+	static const int RING_SIZE = 3;
+	int passCount;
+	int slot;
+	std::vector<GLuint> queries;		// RING_SIZE * passCount
+	std::vector<char> issued;		// whether a pass ran in the frame occupying a slot
+	bool pendingCollect[RING_SIZE];
+	bool pending[RING_SIZE];
+
+	void collect(int ringSlot);
+};
+
+#endif
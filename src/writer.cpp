@@ -0,0 +1,126 @@
+#include"writer.h"
+
+#include<cstring>
+#include<iostream>
+#ifdef _WIN32
+#include<fcntl.h>
+#include<io.h>
+#endif
+
+FrameWriter::FrameWriter(const char* filename, int width, int height, int framesPerSecond, size_t maxQueuedFrames)
+	: valid(false), writtenFrames(0), droppedFrames(0), file(NULL), width(width), height(height), maxQueuedFrames(maxQueuedFrames), closing(false) {
+	const size_t nameLength = strlen(filename);
+	const bool toStdout = strcmp(filename, "-") == 0;
+	y4m = toStdout || (nameLength >= 4 && strcmp(filename + nameLength - 4, ".y4m") == 0);
+
+	if (toStdout) {
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		file = stdout;
+	}
+	else {
+		file = fopen(filename, "wb");
+	}
+	if (file == NULL) {
+		std::cout << "Error: Could not open " << filename << " for capture" << std::endl;
+		return;
+	}
+
+	if (y4m) {
+		fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, framesPerSecond);
+	}
+	valid = true;
+	thread = std::thread(&FrameWriter::run, this);
+}
+
+void FrameWriter::push(const unsigned char* rgba) {
+	if (!valid) return;
+
+	std::vector<unsigned char> frame;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (queue.size() >= maxQueuedFrames) {
+			droppedFrames++;
+			return;
+		}
+		if (!freeFrames.empty()) {
+			frame.swap(freeFrames.back());
+			freeFrames.pop_back();
+		}
+	}
+
+	frame.assign(rgba, rgba + (size_t)width * height * 4);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(std::move(frame));
+	}
+	wake.notify_one();
+}
+
+void FrameWriter::run() {
+	std::vector<unsigned char> scratch((size_t)width * height * 3);
+
+	while (true) {
+		std::vector<unsigned char> frame;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return closing || !queue.empty(); });
+			if (queue.empty()) break;
+			frame.swap(queue.front());
+			queue.pop_front();
+		}
+
+		writeFrame(frame, scratch);
+		writtenFrames++;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		freeFrames.push_back(std::move(frame));
+	}
+	fflush(file);
+}
+
+void FrameWriter::writeFrame(const std::vector<unsigned char>& rgba, std::vector<unsigned char>& scratch) {
+	const size_t planeSize = (size_t)width * height;
+
+	// Frames are read back bottom row first, both outputs are top-down
+	for (int y = 0; y < height; y++) {
+		const unsigned char* row = rgba.data() + (size_t)(height - 1 - y) * width * 4;
+
+		for (int x = 0; x < width; x++) {
+			const int r = row[x * 4], g = row[x * 4 + 1], b = row[x * 4 + 2];
+			const size_t i = (size_t)y * width + x;
+
+			if (y4m) {
+				// BT.601 studio range, the Y4M default
+				scratch[i] = (unsigned char)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+				scratch[planeSize + i] = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+				scratch[planeSize * 2 + i] = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+			}
+			else {
+				scratch[i * 3] = (unsigned char)r;
+				scratch[i * 3 + 1] = (unsigned char)g;
+				scratch[i * 3 + 2] = (unsigned char)b;
+			}
+		}
+	}
+
+	if (y4m) fputs("FRAME\n", file);
+	fwrite(scratch.data(), 1, scratch.size(), file);
+}
+
+void FrameWriter::closeWriter() {
+	if (!valid) return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closing = true;
+	}
+	wake.notify_one();
+	thread.join();
+
+	if (file != stdout) fclose(file);
+	valid = false;
+
+	std::cout << "Captured " << writtenFrames << " frames, dropped " << droppedFrames << std::endl;
+}
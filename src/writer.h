@@ -0,0 +1,43 @@
+#ifndef WRITER_CLASS_H
+#define WRITER_CLASS_H
+
+#include<atomic>
+#include<condition_variable>
+#include<cstdio>
+#include<deque>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+// Streams frames to a file or stdout ("-") from a writer thread. A name ending in .y4m (and
+// stdout) gets a YUV4MPEG2 4:4:4 stream that video tools read directly, anything else raw
+// top-down RGB24. push() only copies the frame into a bounded queue; when the writer falls
+// behind, frames are dropped and counted instead of stalling the render thread
+class FrameWriter {
+public:
+	bool valid;
+	std::atomic<long> writtenFrames;
+	std::atomic<long> droppedFrames;
+
+	FrameWriter(const char* filename, int width, int height, int framesPerSecond, size_t maxQueuedFrames);
+
+	void push(const unsigned char* rgba);	// RGBA8, bottom row first, width * height texels
+	void closeWriter();
+private:
+	FILE* file;
+	bool y4m;
+	int width, height;
+	size_t maxQueuedFrames;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<std::vector<unsigned char>> queue;
+	std::vector<std::vector<unsigned char>> freeFrames;	// recycled frame buffers
+	bool closing;
+	std::thread thread;
+
+	void run();
+	void writeFrame(const std::vector<unsigned char>& rgba, std::vector<unsigned char>& scratch);
+};
+
+#endif